@@ -9,6 +9,20 @@
 // Sync related
 #include "sync.h"
 #include "trace_bank.h"
+#include "critical_path.h"
+#include "speedup.h"
+#include "cost_model.h"
+#include "cache_model.h"
+#include "coherence.h"
+#include "bandwidth.h"
+#include "sync_cost.h"
+#include "numa.h"
+#include "func_profile.h"
+#include "offcpu.h"
+#include "self_profile.h"
+#include "telemetry.h"
+#include "record.h"
+#include "sampling.h"
 
 // Pin related
 #include <unistd.h>
@@ -688,6 +702,8 @@ VOID thread_start_callback(THREADID thread_id, CONTEXT *ctxt, INT32 flags, VOID
         fail();
     }
 
+    cache_model_thread_start(thread_id);
+
     // Create register action
     ACTION action = {
         thread_id,
@@ -709,23 +725,43 @@ VOID thread_fini_callback(THREADID thread_id, CONTEXT const *ctxt, INT32 flags,
 
 VOID Fini(INT32 code, VOID *v)
 {
+    critical_path_report();
+    speedup_report();
+    coherence_report();
+    bandwidth_report();
+    sync_cost_report();
+    numa_report();
+    func_profile_report();
+    sampling_report();
     trace_bank_dump();
+    offcpu_dump();
+    self_profile_report();
     trace_bank_free();
+    critical_path_free();
+    cache_model_free();
+    coherence_free();
+    bandwidth_free();
+    numa_free();
+    func_profile_free();
+    offcpu_free();
+    telemetry_free();
+    record_free();
+    sampling_free();
     cerr << "===============================================" << std::endl;
     cerr << " PINocchio exiting " << std::endl;
     cerr << "===============================================" << std::endl;
 }
 
-VOID ins_handler(THREADID tid)
+VOID ins_handler(THREADID tid, UINT32 weight)
 {
-    // Instruction callback, ONLY update instruction counter
-    all_threads[(int)tid].ins_count++;
+    // Instruction callback, ONLY update instruction counter by its cost
+    all_threads[(int)tid].ins_count += weight;
 }
 
-VOID mem_ins_handler(THREADID tid)
+VOID mem_ins_handler(THREADID tid, UINT32 weight)
 {
     // Memory Instruction callback, update instruction counter
-    all_threads[(int)tid].ins_count++;
+    all_threads[(int)tid].ins_count += weight;
 
     // Sync, which could make it sleep
     ACTION action = {
@@ -735,14 +771,96 @@ VOID mem_ins_handler(THREADID tid)
     sync(&action);
 }
 
+VOID cache_handler(THREADID tid, ADDRINT addr)
+{
+    // Memory operand callback, charge cache misses before syncing
+    all_threads[(int)tid].ins_count += cache_model_access(tid, addr);
+}
+
+VOID coherence_handler(THREADID tid, ADDRINT addr, UINT32 size, BOOL is_write)
+{
+    // Memory operand callback, charge invalidations and transfers before syncing
+    all_threads[(int)tid].ins_count += coherence_access(tid, addr, size, is_write);
+}
+
+VOID numa_handler(THREADID tid, ADDRINT addr)
+{
+    // Memory operand callback, charge accesses to remote pages before syncing
+    all_threads[(int)tid].ins_count += numa_access(tid, addr);
+}
+
+VOID bandwidth_handler(THREADID tid, UINT32 size)
+{
+    // Memory access callback, stall the thread if bandwidth is exhausted
+    all_threads[(int)tid].ins_count += bandwidth_access(tid, all_threads[(int)tid].ins_count, size);
+}
+
+// Called before the instruction handler, so penalties are seen by its sync.
+static VOID instrument_memory(INS ins)
+{
+    UINT32 operands = INS_MemoryOperandCount(ins);
+
+    for(UINT32 op = 0; op < operands; op++) {
+        if(cache_model_enabled() > 0) {
+            INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)cache_handler,
+                                     IARG_THREAD_ID, IARG_MEMORYOP_EA, op, IARG_END);
+        }
+
+        if(coherence_enabled() > 0) {
+            INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)coherence_handler,
+                                     IARG_THREAD_ID, IARG_MEMORYOP_EA, op,
+                                     IARG_UINT32, (UINT32) INS_MemoryOperandSize(ins, op),
+                                     IARG_BOOL, INS_MemoryOperandIsWritten(ins, op), IARG_END);
+        }
+
+        if(numa_enabled() > 0) {
+            INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)numa_handler,
+                                     IARG_THREAD_ID, IARG_MEMORYOP_EA, op, IARG_END);
+        }
+    }
+
+    if(bandwidth_enabled() > 0) {
+        if(INS_IsMemoryRead(ins)) {
+            INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)bandwidth_handler,
+                                     IARG_THREAD_ID, IARG_MEMORYREAD_SIZE, IARG_END);
+        }
+        if(INS_IsMemoryWrite(ins)) {
+            INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)bandwidth_handler,
+                                     IARG_THREAD_ID, IARG_MEMORYWRITE_SIZE, IARG_END);
+        }
+    }
+}
+
+// Virtual speedup region versions, charging instructions at the reduced rate.
+
+VOID region_ins_handler(THREADID tid, UINT32 weight)
+{
+    all_threads[(int)tid].ins_count += speedup_charge(tid, weight);
+}
+
+VOID region_mem_ins_handler(THREADID tid, UINT32 weight)
+{
+    all_threads[(int)tid].ins_count += speedup_charge(tid, weight);
+
+    ACTION action = {
+        .tid = tid,
+        .action_type = ACTION_DONE,
+    };
+    sync(&action);
+}
+
 VOID instruction(INS ins, VOID *v)
 {
+    int region = speedup_in_region(ins);
+    UINT32 weight = cost_model_weight(ins);
+
     if(INS_IsMemoryRead(ins) || INS_IsMemoryWrite(ins)) {
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)mem_ins_handler,
-                       IARG_THREAD_ID, IARG_END);
+        instrument_memory(ins);
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_mem_ins_handler : (AFUNPTR)mem_ins_handler,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
     } else {
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)ins_handler,
-                       IARG_THREAD_ID, IARG_END);
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_ins_handler : (AFUNPTR)ins_handler,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
     }
 }
 
@@ -750,11 +868,8 @@ VOID instruction(INS ins, VOID *v)
 
 // Slightly different version when period is not 0 and results are approximate.
 
-VOID mem_ins_handler_approximate(THREADID tid)
+static inline VOID sync_approximate(THREADID tid)
 {
-    // Memory Instruction callback, update instruction counter
-    all_threads[(int)tid].ins_count++;
-
     if(((all_threads[(int)tid].ins_count - all_threads[(int)tid].sync_holder) / sync_period) > 0) {
         all_threads[(int)tid].sync_holder = all_threads[(int)tid].ins_count;
 
@@ -767,14 +882,111 @@ VOID mem_ins_handler_approximate(THREADID tid)
     }
 }
 
+VOID mem_ins_handler_approximate(THREADID tid, UINT32 weight)
+{
+    // Memory Instruction callback, update instruction counter
+    all_threads[(int)tid].ins_count += weight;
+    sync_approximate(tid);
+}
+
+VOID region_mem_ins_handler_approximate(THREADID tid, UINT32 weight)
+{
+    all_threads[(int)tid].ins_count += speedup_charge(tid, weight);
+    sync_approximate(tid);
+}
+
 VOID instruction_approximate(INS ins, VOID *v)
 {
+    int region = speedup_in_region(ins);
+    UINT32 weight = cost_model_weight(ins);
+
     if(INS_IsMemoryRead(ins) || INS_IsMemoryWrite(ins)) {
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)mem_ins_handler_approximate,
-                       IARG_THREAD_ID, IARG_END);
+        instrument_memory(ins);
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_mem_ins_handler_approximate : (AFUNPTR)mem_ins_handler_approximate,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
     } else {
-        INS_InsertCall(ins, IPOINT_BEFORE, (AFUNPTR)ins_handler,
-                       IARG_THREAD_ID, IARG_END);
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_ins_handler : (AFUNPTR)ins_handler,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
+    }
+}
+
+// Sampled version, only syncing inside detailed windows and just counting
+// in between. Windows still sync every -p instructions.
+
+static inline VOID sync_sampled(THREADID tid)
+{
+    if(sampling_detailed(all_threads[(int)tid].ins_count) > 0) {
+        sync_approximate(tid);
+    }
+}
+
+VOID mem_ins_handler_sampled(THREADID tid, UINT32 weight)
+{
+    all_threads[(int)tid].ins_count += weight;
+    sync_sampled(tid);
+}
+
+VOID region_mem_ins_handler_sampled(THREADID tid, UINT32 weight)
+{
+    all_threads[(int)tid].ins_count += speedup_charge(tid, weight);
+    sync_sampled(tid);
+}
+
+VOID instruction_sampled(INS ins, VOID *v)
+{
+    int region = speedup_in_region(ins);
+    UINT32 weight = cost_model_weight(ins);
+
+    if(INS_IsMemoryRead(ins) || INS_IsMemoryWrite(ins)) {
+        instrument_memory(ins);
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_mem_ins_handler_sampled : (AFUNPTR)mem_ins_handler_sampled,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
+    } else {
+        INS_InsertCall(ins, IPOINT_BEFORE, region > 0 ? (AFUNPTR)region_ins_handler : (AFUNPTR)ins_handler,
+                       IARG_THREAD_ID, IARG_UINT32, weight, IARG_END);
+    }
+}
+
+// Function profiler, one call per basic block with its total weight.
+
+VOID profile_handler(THREADID tid, UINT32 function, UINT32 weight)
+{
+    func_profile_charge(tid, function, weight);
+}
+
+VOID profile_trace(TRACE trace, VOID *v)
+{
+    for(BBL bbl = TRACE_BblHead(trace); BBL_Valid(bbl); bbl = BBL_Next(bbl)) {
+        UINT32 weight = 0;
+        for(INS ins = BBL_InsHead(bbl); INS_Valid(ins); ins = INS_Next(ins)) {
+            weight += cost_model_weight(ins);
+        }
+
+        BBL_InsertCall(bbl, IPOINT_BEFORE, (AFUNPTR)profile_handler, IARG_THREAD_ID,
+                       IARG_UINT32, func_profile_id(BBL_InsHead(bbl)), IARG_UINT32, weight, IARG_END);
+    }
+}
+
+// Shadow stacks of the off-CPU profile.
+
+VOID call_handler(THREADID tid, ADDRINT target, ADDRINT sp)
+{
+    offcpu_call(tid, target, sp);
+}
+
+VOID ret_handler(THREADID tid, ADDRINT sp)
+{
+    offcpu_ret(tid, sp);
+}
+
+VOID shadow_stack_instruction(INS ins, VOID *v)
+{
+    if(INS_IsCall(ins)) {
+        INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)call_handler, IARG_THREAD_ID,
+                                 IARG_BRANCH_TARGET_ADDR, IARG_REG_VALUE, REG_STACK_PTR, IARG_END);
+    } else if(INS_IsRet(ins)) {
+        INS_InsertPredicatedCall(ins, IPOINT_BEFORE, (AFUNPTR)ret_handler, IARG_THREAD_ID,
+                                 IARG_REG_VALUE, REG_STACK_PTR, IARG_END);
     }
 }
 
@@ -787,19 +999,57 @@ int main(int argc, char *argv[])
         return knob_usage();
     }
 
+    if(knob_output_format.Value() != "json" && knob_output_format.Value() != "binary" &&
+            knob_output_format.Value() != "chrome") {
+        cerr << "[PINocchio] Error: Unknown output format: " << knob_output_format.Value() << std::endl;
+        return knob_usage();
+    }
+
+    if(knob_time_unit.Value() != "ns" && knob_time_unit.Value() != "us" && knob_time_unit.Value() != "ms") {
+        cerr << "[PINocchio] Error: Unknown time unit: " << knob_time_unit.Value() << std::endl;
+        return knob_usage();
+    }
+
     bool pram = !knob_time_based.Value();
     sync_period = knob_sync_frenquency.Value();
 
+    // Before sync, so it sees the first thread start.
+    self_profile_init();
+
     // Initialize sync structure
     sync_init(pram);
 
+    if(speedup_init() < 0 || cost_model_init() < 0 || cache_model_init() < 0 || coherence_init() < 0 ||
+            bandwidth_init() < 0 || numa_init() < 0 || func_profile_init() < 0 || offcpu_init(pram) < 0 ||
+            sync_cost_init(pram > 0 ? knob_sync_cost.Value().c_str() : "") < 0 || telemetry_init() < 0 ||
+            record_init(pram) < 0 || sampling_init(pram) < 0) {
+        return knob_usage();
+    }
+    if(speedup_enabled() > 0 && pram == 0) {
+        cerr << "[PINocchio] Warning: Virtual speedup needs PRAM mode, ignoring it." << std::endl;
+    }
+    if(knob_sync_cost.Value() != "" && pram == 0) {
+        cerr << "[PINocchio] Warning: Sync costs need PRAM mode, ignoring them." << std::endl;
+    }
+
     // Hadler for instructions
     if(pram > 0) {
-        if(sync_period == 1) {
+        if(sampling_enabled() > 0) {
+            INS_AddInstrumentFunction(instruction_sampled, 0);
+        } else if(sync_period == 1) {
             INS_AddInstrumentFunction(instruction, 0);
         } else {
             INS_AddInstrumentFunction(instruction_approximate, 0);
         }
+
+        if(func_profile_enabled() > 0) {
+            TRACE_AddInstrumentFunction(profile_trace, 0);
+        }
+        if(offcpu_enabled() > 0) {
+            INS_AddInstrumentFunction(shadow_stack_instruction, 0);
+        }
+    } else if(func_profile_enabled() > 0) {
+        cerr << "[PINocchio] Warning: Function profile needs PRAM mode, ignoring it." << std::endl;
     }
 
     // Handler for thread creation
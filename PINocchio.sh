@@ -38,11 +38,160 @@ while test $# -gt 0; do
                         shift
                         PIN_FLAGS="$PIN_FLAGS -t"
                         ;;
+                -u)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -u $1"
+                        shift
+                        ;;
                 -o)
                         shift
                         PIN_FLAGS="$PIN_FLAGS -o $1"
                         shift
                         ;;
+                -f)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -f $1"
+                        shift
+                        ;;
+                -speedup-region)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -speedup-region $1"
+                        shift
+                        ;;
+                -speedup)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -speedup $1"
+                        shift
+                        ;;
+                -cost-table)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cost-table $1"
+                        shift
+                        ;;
+                -cache-line)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache-line $1"
+                        shift
+                        ;;
+                -cache-l1)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache-l1 $1"
+                        shift
+                        ;;
+                -cache-l2)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache-l2 $1"
+                        shift
+                        ;;
+                -cache-llc)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache-llc $1"
+                        shift
+                        ;;
+                -cache-memory)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache-memory $1"
+                        shift
+                        ;;
+                -cache)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -cache"
+                        ;;
+                -coherence-invalidate)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -coherence-invalidate $1"
+                        shift
+                        ;;
+                -coherence-transfer)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -coherence-transfer $1"
+                        shift
+                        ;;
+                -coherence)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -coherence"
+                        ;;
+                -bandwidth-window)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -bandwidth-window $1"
+                        shift
+                        ;;
+                -bandwidth)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -bandwidth $1"
+                        shift
+                        ;;
+                -sync-cost)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -sync-cost $1"
+                        shift
+                        ;;
+                -numa-page)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -numa-page $1"
+                        shift
+                        ;;
+                -numa-remote)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -numa-remote $1"
+                        shift
+                        ;;
+                -numa)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -numa $1"
+                        shift
+                        ;;
+                -profile-top)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -profile-top $1"
+                        shift
+                        ;;
+                -profile)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -profile"
+                        ;;
+                -offcpu)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -offcpu $1"
+                        shift
+                        ;;
+                -self-profile)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -self-profile"
+                        ;;
+                -telemetry)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -telemetry $1"
+                        shift
+                        ;;
+                -telemetry-period)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -telemetry-period $1"
+                        shift
+                        ;;
+                -record)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -record $1"
+                        shift
+                        ;;
+                -sample-window)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -sample-window $1"
+                        shift
+                        ;;
+                -sample-interval)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -sample-interval $1"
+                        shift
+                        ;;
+                -critical-path)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -critical-path"
+                        ;;
+                -stats-only)
+                        shift
+                        PIN_FLAGS="$PIN_FLAGS -stats-only"
+                        ;;
                 *)
                         break
                         ;;
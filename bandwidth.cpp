@@ -0,0 +1,299 @@
+/* bandwidth.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "bandwidth.h"
+#include "trace_bank.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define RING_SIZE 64                    // Windows open at a time
+#define MAX_REPORT 4096                 // Utilization samples kept
+
+typedef struct {
+    UINT64 window;
+    UINT64 bytes;
+    int carried;                    // Backlog of the previous window taken
+} WINDOW;
+
+typedef struct {
+    UINT64 window;                  // Current window of the thread
+    UINT64 pending;                 // Bytes not published yet
+    UINT64 bytes;
+    UINT64 stall;
+} THREAD_BANDWIDTH;
+
+static int enabled;
+static UINT64 budget;               // Bytes per cycle
+static UINT64 window_size;          // Cycles per window
+static UINT64 capacity;             // Bytes per window
+
+static WINDOW ring[RING_SIZE];
+static PIN_MUTEX ring_lock;
+static THREAD_BANDWIDTH threads[MAX_THREADS];
+
+// Bytes per report sample, each sample covering 2^report_scale windows.
+static UINT64 report[MAX_REPORT];
+static UINT32 report_scale;
+static UINT64 report_size;
+
+int bandwidth_init()
+{
+    enabled = knob_bandwidth.Value() > 0 ? 1 : 0;
+    memset(threads, 0, sizeof(threads));
+    memset(report, 0, sizeof(report));
+    report_scale = 0;
+    report_size = 0;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    if(knob_bandwidth_window.Value() <= 0) {
+        cerr << "[PINocchio] Error: Bandwidth window should be positive: " << knob_bandwidth_window.Value() << std::endl;
+        return -1;
+    }
+
+    budget = knob_bandwidth.Value();
+    window_size = knob_bandwidth_window.Value();
+    capacity = budget * window_size;
+
+    for(int i = 0; i < RING_SIZE; i++) {
+        ring[i].window = i;
+        ring[i].bytes = 0;
+        ring[i].carried = 0;
+    }
+    PIN_MutexInit(&ring_lock);
+
+    trace_bank_add_section("bandwidth", bandwidth_dump);
+    return 0;
+}
+
+int bandwidth_enabled()
+{
+    return enabled;
+}
+
+// Keep the bytes of a closed window, merging pairs of samples if needed.
+static void report_add(UINT64 window, UINT64 bytes)
+{
+    while((window >> report_scale) >= MAX_REPORT) {
+        for(int i = 0; i < MAX_REPORT / 2; i++) {
+            report[i] = report[2 * i] + report[2 * i + 1];
+        }
+        memset(&report[MAX_REPORT / 2], 0, sizeof(UINT64) * MAX_REPORT / 2);
+        report_scale++;
+        report_size = (report_size + 1) / 2;
+    }
+
+    UINT64 i = window >> report_scale;
+    report[i] += bytes;
+    if(i + 1 > report_size) {
+        report_size = i + 1;
+    }
+}
+
+// Add pending bytes of a thread to its window, returning the stall.
+static UINT32 publish(THREAD_BANDWIDTH *t)
+{
+    UINT64 excess = 0;
+
+    if(t->pending == 0) {
+        return 0;
+    }
+
+    PIN_MutexLock(&ring_lock);
+    WINDOW *w = &ring[t->window % RING_SIZE];
+
+    if(w->window < t->window) {
+        // Slot still holds an old window, close it.
+        report_add(w->window, w->bytes);
+        w->window = t->window;
+        w->bytes = 0;
+        w->carried = 0;
+    }
+
+    if(w->window > t->window) {
+        // Too far behind, its window is gone. Just account it.
+        report_add(t->window, t->pending);
+    } else {
+        if(w->carried == 0) {
+            // What the previous window couldn't serve is still queued.
+            WINDOW *prev = &ring[(t->window + RING_SIZE - 1) % RING_SIZE];
+            if(prev->window + 1 == t->window && prev->bytes > capacity) {
+                w->bytes += prev->bytes - capacity;
+                prev->bytes = capacity;
+            }
+            w->carried = 1;
+        }
+
+        UINT64 before = w->bytes;
+        w->bytes += t->pending;
+        if(w->bytes > capacity) {
+            excess = w->bytes - (before > capacity ? before : capacity);
+
+            // Next window already took the backlog, queue it there.
+            WINDOW *next = &ring[(t->window + 1) % RING_SIZE];
+            if(next->window == t->window + 1 && next->carried > 0) {
+                next->bytes += excess;
+                w->bytes -= excess;
+            }
+        }
+    }
+    PIN_MutexUnlock(&ring_lock);
+
+    t->bytes += t->pending;
+    t->pending = 0;
+
+    // Time to drain what went over, rounding up.
+    UINT32 stall = (UINT32)((excess + budget - 1) / budget);
+    t->stall += stall;
+    return stall;
+}
+
+UINT32 bandwidth_access(THREADID tid, UINT64 time, UINT32 bytes)
+{
+    THREAD_BANDWIDTH *t = &threads[tid];
+    UINT64 window = time / window_size;
+    UINT32 stall = 0;
+
+    if(window != t->window) {
+        stall = publish(t);
+        t->window = window;
+    }
+
+    t->pending += bytes;
+    if(t->pending >= BANDWIDTH_BATCH) {
+        stall += publish(t);
+    }
+
+    return stall;
+}
+
+// Execution is over, publish and close everything. Backlog still queued is
+// served on the following windows.
+static void close_windows()
+{
+    UINT64 first = (UINT64) -1;
+    UINT64 last = 0;
+    UINT64 backlog = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        publish(&threads[i]);
+    }
+
+    for(int i = 0; i < RING_SIZE; i++) {
+        if(ring[i].bytes > 0) {
+            first = ring[i].window < first ? ring[i].window : first;
+            last = ring[i].window > last ? ring[i].window : last;
+        }
+    }
+    if(first > last) {
+        return;
+    }
+
+    for(UINT64 window = first; window <= last || backlog > 0; window++) {
+        WINDOW *w = &ring[window % RING_SIZE];
+        UINT64 bytes = backlog;
+
+        if(w->window == window) {
+            bytes += w->bytes;
+            w->bytes = 0;
+        }
+        backlog = bytes > capacity ? bytes - capacity : 0;
+        report_add(window, bytes - backlog);
+    }
+}
+
+static UINT64 peak_utilization()
+{
+    UINT64 peak = 0;
+    for(UINT64 i = 0; i < report_size; i++) {
+        if(report[i] > peak) {
+            peak = report[i];
+        }
+    }
+    return (100 * peak) / (capacity << report_scale);
+}
+
+void bandwidth_report()
+{
+    UINT64 stall = 0;
+    UINT64 bytes = 0;
+
+    if(enabled == 0) {
+        return;
+    }
+
+    close_windows();
+    for(int i = 0; i < MAX_THREADS; i++) {
+        stall += threads[i].stall;
+        bytes += threads[i].bytes;
+    }
+
+    cerr << "[PINocchio] Bandwidth: " << bytes << " bytes, peak window at " << peak_utilization()
+         << "% of the budget, threads stalled for " << stall << " cycles" << std::endl;
+}
+
+void bandwidth_dump(OUT_BUFFER *b)
+{
+    char str[32];
+    UINT64 stall = 0;
+    UINT64 bytes = 0;
+
+    close_windows();
+    for(int i = 0; i < MAX_THREADS; i++) {
+        stall += threads[i].stall;
+        bytes += threads[i].bytes;
+    }
+
+    out_buffer_str(b, "{\n    \"budget\":");
+    out_buffer_u64(b, budget);
+    out_buffer_str(b, ", \"window\":");
+    out_buffer_u64(b, window_size << report_scale);
+    out_buffer_str(b, ", \"bytes\":");
+    out_buffer_u64(b, bytes);
+    out_buffer_str(b, ", \"stall\":");
+    out_buffer_u64(b, stall);
+
+    out_buffer_str(b, ",\n    \"per-thread\": [");
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_BANDWIDTH *t = &threads[i];
+        if(t->bytes == 0) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "{\"pin-tid\":" : ", {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        out_buffer_str(b, ", \"bytes\":");
+        out_buffer_u64(b, t->bytes);
+        out_buffer_str(b, ", \"stall\":");
+        out_buffer_u64(b, t->stall);
+        out_buffer_char(b, '}');
+    }
+
+    // Utilization of each window, as a fraction of its budget.
+    out_buffer_str(b, "],\n    \"utilization\": [");
+    double window_capacity = (double) capacity * (1ULL << report_scale);
+    for(UINT64 i = 0; i < report_size; i++) {
+        snprintf(str, sizeof(str), i > 0 ? ", %.3f" : "%.3f", report[i] / window_capacity);
+        out_buffer_str(b, str);
+    }
+    out_buffer_str(b, "]\n  }");
+}
+
+void bandwidth_free()
+{
+    enabled = 0;
+}
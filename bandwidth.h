@@ -0,0 +1,49 @@
+/* bandwidth.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef BANDWIDTH_H_
+#define BANDWIDTH_H_
+
+/*
+Shared memory bandwidth model (-bandwidth BYTES_PER_CYCLE). Simulated time is
+split in windows of -bandwidth-window cycles, and the bytes moved by all
+threads are added to the window they happen in. Once a window goes over its
+budget, the thread pushing it over is stalled for the time the excess takes
+to drain at the budget rate, and the excess is carried to the next window.
+
+Threads add their bytes locally and only publish them to the shared windows
+when they move to another window or after BANDWIDTH_BATCH bytes, so the lock
+is rarely taken. Windows are kept on a ring, as PRAM threads never drift
+much apart, and the utilization of each one is kept for the report, merging
+neighbours once there are too many.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+#define BANDWIDTH_BATCH 256             // Bytes accumulated before publishing
+
+// Parse bandwidth knobs. Returns 0 on success, -1 if invalid.
+int bandwidth_init();
+
+// Returns 1 if the bandwidth model is enabled.
+int bandwidth_enabled();
+
+// Thread tid moving bytes at time, returning the stall in cycles.
+UINT32 bandwidth_access(THREADID tid, UINT64 time, UINT32 bytes);
+
+// Print a summary on stderr.
+void bandwidth_report();
+
+// Section writer of the per-window utilization, see trace_bank_add_section.
+void bandwidth_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void bandwidth_free();
+
+#endif // BANDWIDTH_H_
@@ -0,0 +1,151 @@
+/* dump_bench.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+/*
+Benchmark for the trace dump: 256 threads with 4096 changes each (a full
+bank) written in the trace.json layout, once with trace_samples_write, the
+sample writer used by trace_bank_dump, and once with the previous per-thread
+string building. Every 8th change is a wake up, so the waker fields are
+written as well.
+
+Usage: dump_bench [output file] [repetitions]
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../out_buffer.h"
+#include "../trace_samples.h"
+
+#define BENCH_THREADS 256
+#define BENCH_CHANGES 4096
+
+static CHANGE *samples[BENCH_THREADS];
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void fill()
+{
+    srand(42);
+    for(int t = 0; t < BENCH_THREADS; t++) {
+        samples[t] = (CHANGE *) malloc(BENCH_CHANGES * sizeof(CHANGE));
+
+        uint64_t time = t * 1000;
+        for(int i = 0; i < BENCH_CHANGES; i++) {
+            samples[t][i].time = time;
+            samples[t][i].status = (THREAD_STATUS)(i % 2);
+            samples[t][i].waker = NO_WAKER;
+            samples[t][i].object = NULL;
+            samples[t][i].cause = CAUSE_NONE;
+            if(i % 8 == 0 && i > 0) {
+                samples[t][i].waker = (t + 1) % BENCH_THREADS;
+                samples[t][i].object = (void *)(uintptr_t)(0x601040 + 64 * (i % 16));
+                samples[t][i].cause = CAUSE_MUTEX;
+            }
+            time += 1 + rand() % 100000;
+        }
+        samples[t][BENCH_CHANGES - 1].status = FINISHED;
+    }
+}
+
+// Same layout as trace_bank_dump, samples go through its writer.
+static void dump_streaming(const char *filename)
+{
+    static OUT_BUFFER b;
+
+    out_buffer_open(&b, filename);
+    out_buffer_str(&b, "{\n  \"end\":0,\n  \"unit\": \"Cycles\",\n  \"threads\": [\n");
+    for(int t = 0; t < BENCH_THREADS; t++) {
+        if(t > 0) {
+            out_buffer_str(&b, ",\n");
+        }
+        out_buffer_str(&b, "    {\n      \"pin-tid\":");
+        out_buffer_u64(&b, t);
+        out_buffer_str(&b, ",\n      \"start\":");
+        out_buffer_u64(&b, samples[t][0].time);
+        out_buffer_str(&b, ",\n      \"samples\":");
+        trace_samples_write(&b, samples[t], BENCH_CHANGES, NULL);
+        out_buffer_str(&b, "\n    }");
+    }
+    out_buffer_str(&b, "\n  ]\n}\n");
+    out_buffer_close(&b);
+}
+
+// Previous approach: a per-thread string grown by formatting at its end.
+// (The original formatted the string into itself, which is undefined, so
+// strlen is used to keep the same quadratic behavior.)
+static void dump_legacy(const char *filename)
+{
+    static char str[48 * BENCH_CHANGES];
+    FILE *f = fopen(filename, "w");
+
+    fprintf(f, "{\n  \"end\":0,\n  \"unit\": \"Cycles\",\n  \"threads\": [\n");
+    for(int t = 0; t < BENCH_THREADS; t++) {
+        sprintf(str, "[");
+        for(int i = 0; i < BENCH_CHANGES; i++) {
+            if(i > 0) {
+                sprintf(str + strlen(str), ", ");
+            }
+            CHANGE *c = &samples[t][i];
+            if(c->waker != NO_WAKER) {
+                sprintf(str + strlen(str), "[%lu, %c, %u, %lu, \"%s\"]", (unsigned long) c->time,
+                        (char)(0x30 + c->status), c->waker, (unsigned long)(uintptr_t) c->object,
+                        wake_cause_name(c->cause));
+            } else {
+                sprintf(str + strlen(str), "[%lu, %c]", (unsigned long) c->time, (char)(0x30 + c->status));
+            }
+        }
+        sprintf(str + strlen(str), "]");
+
+        if(t > 0) {
+            fprintf(f, ",\n");
+        }
+        fprintf(f, "    {\n      \"pin-tid\":%d,\n      \"start\":%lu,\n      \"samples\":%s\n    }",
+                t, (unsigned long) samples[t][0].time, str);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filename = argc > 1 ? argv[1] : "dump_bench.json";
+    int repetitions = argc > 2 ? atoi(argv[2]) : 5;
+
+    fill();
+
+    double best_streaming = 0, best_legacy = 0;
+    for(int r = 0; r < repetitions; r++) {
+        double start = now();
+        dump_streaming(filename);
+        double streaming = now() - start;
+
+        start = now();
+        dump_legacy(filename);
+        double legacy = now() - start;
+
+        if(r == 0 || streaming < best_streaming) {
+            best_streaming = streaming;
+        }
+        if(r == 0 || legacy < best_legacy) {
+            best_legacy = legacy;
+        }
+    }
+
+    printf("dump_bench: %d threads x %d changes, best of %d\n", BENCH_THREADS, BENCH_CHANGES, repetitions);
+    printf("@STREAMING: %.4f\n", best_streaming);
+    printf("@LEGACY: %.4f\n", best_legacy);
+    remove(filename);
+    return 0;
+}
@@ -0,0 +1,254 @@
+/* cache_model.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "cache_model.h"
+#include "trace_bank.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define CACHE_LEVELS 3
+
+typedef enum {
+    LEVEL_L1 = 0,
+    LEVEL_L2 = 1,
+    LEVEL_LLC = 2,
+}   CACHE_LEVEL;
+
+typedef struct {
+    UINT32 size_kb;
+    UINT32 assoc;
+    UINT32 latency;
+    UINT32 sets;                    // Power of two
+} CACHE_CONFIG;
+
+// Set-associative tag array, each set ordered from most to least recently used.
+typedef struct {
+    UINT64 *tags;                   // Line number + 1, 0 is an invalid way
+    UINT32 set_mask;
+    UINT32 assoc;
+} CACHE;
+
+typedef struct {
+    CACHE l1;
+    CACHE l2;
+    UINT64 hits[CACHE_LEVELS];
+    UINT64 misses[CACHE_LEVELS];
+    UINT64 penalty;
+} THREAD_CACHE;
+
+static const char *level_names[CACHE_LEVELS] = {"l1", "l2", "llc"};
+
+static int enabled;
+static UINT32 line_bits;
+static UINT32 memory_latency;
+static CACHE_CONFIG config[CACHE_LEVELS];
+
+static THREAD_CACHE caches[MAX_THREADS];
+static CACHE llc;
+static PIN_MUTEX llc_mutex;
+
+static int parse_level(CACHE_LEVEL level, const string &value)
+{
+    CACHE_CONFIG *c = &config[level];
+    UINT32 line_size = 1 << line_bits;
+
+    if(sscanf(value.c_str(), "%u:%u:%u", &c->size_kb, &c->assoc, &c->latency) != 3 ||
+            c->size_kb == 0 || c->assoc == 0) {
+        cerr << "[PINocchio] Error: Invalid " << level_names[level] << " cache, expected SIZE_KB:ASSOC:LATENCY: " << value << std::endl;
+        return -1;
+    }
+
+    c->sets = (c->size_kb * 1024) / (line_size * c->assoc);
+    if(c->sets == 0 || (c->sets & (c->sets - 1)) != 0) {
+        cerr << "[PINocchio] Error: " << level_names[level] << " cache should have a power of two number of sets: " << value << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+static void cache_alloc(CACHE *c, CACHE_CONFIG *config)
+{
+    c->tags = (UINT64 *) calloc((size_t) config->sets * config->assoc, sizeof(UINT64));
+    if(c->tags == NULL) {
+        cerr << "[PINocchio] Error: Out of memory allocating cache model." << std::endl;
+        fail();
+    }
+    c->set_mask = config->sets - 1;
+    c->assoc = config->assoc;
+}
+
+int cache_model_init()
+{
+    enabled = knob_cache.Value() ? 1 : 0;
+    memset(caches, 0, sizeof(caches));
+    llc.tags = NULL;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    UINT32 line_size = knob_cache_line.Value();
+    if(line_size == 0 || (line_size & (line_size - 1)) != 0) {
+        cerr << "[PINocchio] Error: Cache line size should be a power of two: " << line_size << std::endl;
+        return -1;
+    }
+    for(line_bits = 0; (1U << line_bits) < line_size; line_bits++);
+
+    if(parse_level(LEVEL_L1, knob_cache_l1.Value()) < 0 ||
+            parse_level(LEVEL_L2, knob_cache_l2.Value()) < 0 ||
+            parse_level(LEVEL_LLC, knob_cache_llc.Value()) < 0) {
+        return -1;
+    }
+    memory_latency = knob_cache_memory.Value();
+
+    cache_alloc(&llc, &config[LEVEL_LLC]);
+    PIN_MutexInit(&llc_mutex);
+
+    trace_bank_add_section("cache", cache_model_dump);
+    return 0;
+}
+
+int cache_model_enabled()
+{
+    return enabled;
+}
+
+void cache_model_thread_start(THREADID tid)
+{
+    if(enabled == 0 || caches[tid].l1.tags != NULL) {
+        return;
+    }
+
+    cache_alloc(&caches[tid].l1, &config[LEVEL_L1]);
+    cache_alloc(&caches[tid].l2, &config[LEVEL_L2]);
+}
+
+// Look for line, always leaving it as the most recently used of its set.
+// Returns 1 on hit, 0 on miss (evicting the least recently used).
+static int cache_lookup(CACHE *c, UINT64 line)
+{
+    UINT64 *set = &c->tags[(line & c->set_mask) * c->assoc];
+    UINT64 tag = line + 1;
+
+    UINT32 way;
+    for(way = 0; way < c->assoc - 1; way++) {
+        if(set[way] == tag) {
+            break;
+        }
+    }
+    int hit = set[way] == tag;
+
+    // Shift the others down, way is either the hit or the evicted one.
+    for(; way > 0; way--) {
+        set[way] = set[way - 1];
+    }
+    set[0] = tag;
+
+    return hit;
+}
+
+UINT32 cache_model_access(THREADID tid, ADDRINT addr)
+{
+    THREAD_CACHE *t = &caches[tid];
+    UINT64 line = (UINT64) addr >> line_bits;
+    UINT32 latency;
+
+    if(cache_lookup(&t->l1, line) > 0) {
+        t->hits[LEVEL_L1]++;
+        return 0;
+    }
+    t->misses[LEVEL_L1]++;
+
+    if(cache_lookup(&t->l2, line) > 0) {
+        t->hits[LEVEL_L2]++;
+        latency = config[LEVEL_L2].latency;
+    } else {
+        t->misses[LEVEL_L2]++;
+
+        PIN_MutexLock(&llc_mutex);
+        int hit = cache_lookup(&llc, line);
+        PIN_MutexUnlock(&llc_mutex);
+
+        if(hit > 0) {
+            t->hits[LEVEL_LLC]++;
+            latency = config[LEVEL_LLC].latency;
+        } else {
+            t->misses[LEVEL_LLC]++;
+            latency = memory_latency;
+        }
+    }
+
+    UINT32 penalty = latency > config[LEVEL_L1].latency ? latency - config[LEVEL_L1].latency : 0;
+    t->penalty += penalty;
+    return penalty;
+}
+
+void cache_model_dump(OUT_BUFFER *b)
+{
+    out_buffer_str(b, "{\n    \"line\":");
+    out_buffer_u64(b, 1 << line_bits);
+    out_buffer_str(b, ", \"memory-latency\":");
+    out_buffer_u64(b, memory_latency);
+
+    for(int l = 0; l < CACHE_LEVELS; l++) {
+        out_buffer_str(b, ", \"");
+        out_buffer_str(b, level_names[l]);
+        out_buffer_str(b, "\": {\"size-kb\":");
+        out_buffer_u64(b, config[l].size_kb);
+        out_buffer_str(b, ", \"assoc\":");
+        out_buffer_u64(b, config[l].assoc);
+        out_buffer_str(b, ", \"latency\":");
+        out_buffer_u64(b, config[l].latency);
+        out_buffer_char(b, '}');
+    }
+
+    out_buffer_str(b, ",\n    \"per-thread\": [");
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_CACHE *t = &caches[i];
+        if(t->l1.tags == NULL) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "\n      {\"pin-tid\":" : ",\n      {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        for(int l = 0; l < CACHE_LEVELS; l++) {
+            out_buffer_str(b, ", \"");
+            out_buffer_str(b, level_names[l]);
+            out_buffer_str(b, "-hits\":");
+            out_buffer_u64(b, t->hits[l]);
+            out_buffer_str(b, ", \"");
+            out_buffer_str(b, level_names[l]);
+            out_buffer_str(b, "-misses\":");
+            out_buffer_u64(b, t->misses[l]);
+        }
+        out_buffer_str(b, ", \"penalty\":");
+        out_buffer_u64(b, t->penalty);
+        out_buffer_char(b, '}');
+    }
+    out_buffer_str(b, "\n    ]\n  }");
+}
+
+void cache_model_free()
+{
+    for(int i = 0; i < MAX_THREADS; i++) {
+        free(caches[i].l1.tags);
+        free(caches[i].l2.tags);
+        caches[i].l1.tags = NULL;
+        caches[i].l2.tags = NULL;
+    }
+    free(llc.tags);
+    llc.tags = NULL;
+}
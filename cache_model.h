@@ -0,0 +1,45 @@
+/* cache_model.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef CACHE_MODEL_H_
+#define CACHE_MODEL_H_
+
+/*
+Optional cache hierarchy (-cache): private L1 and L2 per thread and a shared
+LLC, all set-associative with LRU replacement. Each level is described as
+SIZE_KB:ASSOC:LATENCY, latency being the load-to-use cycles of an access
+served by that level. An access served by L1 costs nothing extra, as the
+instruction itself already pays for it, others are charged the difference
+to the L1 latency on the thread's ins_count.
+
+Tags are kept on arrays allocated when a thread starts, nothing is allocated
+per access. The LLC is protected by a mutex, only taken on L2 misses.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+// Parse cache knobs. Returns 0 on success, -1 if invalid.
+int cache_model_init();
+
+// Returns 1 if the cache model is enabled.
+int cache_model_enabled();
+
+// Allocate private caches of a starting thread.
+void cache_model_thread_start(THREADID tid);
+
+// Access addr by tid, returning the penalty in cycles.
+UINT32 cache_model_access(THREADID tid, ADDRINT addr);
+
+// Section writer of cache statistics, see trace_bank_add_section.
+void cache_model_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void cache_model_free();
+
+#endif // CACHE_MODEL_H_
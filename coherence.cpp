@@ -0,0 +1,424 @@
+/* coherence.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "coherence.h"
+#include "trace_bank.h"
+#include "top.h"
+#include "thread.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define STRIPES 64                          // Directory stripes, power of two
+#define SHARER_WORDS (MAX_THREADS / 64)     // Sharers bitmask size
+#define HOT_LINES 10                        // Lines reported
+#define OFFSET_BITS 64                      // Granularity of offsets masks
+#define LINE_USERS 4                        // Threads with offsets kept per line
+#define STRIPE_LINES 4096                   // Lines kept per stripe before evicting
+
+typedef enum {
+    LINE_INVALID = 0,
+    LINE_SHARED = 1,
+    LINE_EXCLUSIVE = 2,
+    LINE_MODIFIED = 3,
+}   LINE_STATE;
+
+// How a thread used a given line.
+typedef struct {
+    THREADID tid;
+    UINT64 offsets;                 // Touched chunks, see OFFSET_BITS
+    UINT64 reads;
+    UINT64 writes;
+} LINE_USER;
+
+typedef struct _LINE_ENTRY LINE_ENTRY;
+struct _LINE_ENTRY {
+    UINT64 line;
+
+    UT_hash_handle hh;
+
+    LINE_STATE state;
+    THREADID owner;                 // Only valid on EXCLUSIVE and MODIFIED
+    UINT64 sharers[SHARER_WORDS];   // Threads holding a copy
+
+    UINT64 invalidations;           // Copies invalidated by writes
+    UINT64 transfers;               // Modified copies read by others
+
+    int referenced;                 // Touched since the clock hand passed
+    UINT64 touched[SHARER_WORDS];   // Every thread that used the line
+    LINE_USER users[LINE_USERS];    // Details of the first ones
+    int total_users;
+};
+
+typedef struct {
+    PIN_MUTEX lock;
+    LINE_ENTRY *lines;
+
+    LINE_ENTRY *pool;               // STRIPE_LINES entries, allocated on first use
+    int used;
+    int hand;                       // Clock eviction
+    UINT64 evictions;
+} STRIPE;
+
+typedef struct {
+    UINT64 invalidations;           // Caused by its writes
+    UINT64 transfers;               // Caused by its reads
+    UINT64 penalty;
+} THREAD_COHERENCE;
+
+static int enabled;
+static UINT32 line_bits;
+static UINT32 chunk_bits;           // log2 of bytes per offsets bit
+static UINT32 invalidate_cost;
+static UINT32 transfer_cost;
+
+static STRIPE stripes[STRIPES];
+static THREAD_COHERENCE threads[MAX_THREADS];
+
+static TOP hot;
+
+int coherence_init()
+{
+    enabled = knob_coherence.Value() ? 1 : 0;
+    memset(threads, 0, sizeof(threads));
+    top_init(&hot, HOT_LINES);
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    UINT32 line_size = knob_cache_line.Value();
+    if(line_size == 0 || (line_size & (line_size - 1)) != 0) {
+        cerr << "[PINocchio] Error: Cache line size should be a power of two: " << line_size << std::endl;
+        return -1;
+    }
+    for(line_bits = 0; (1U << line_bits) < line_size; line_bits++);
+    chunk_bits = line_size > OFFSET_BITS ? line_bits - 6 : 0;
+
+    invalidate_cost = knob_coherence_invalidate.Value();
+    transfer_cost = knob_coherence_transfer.Value();
+
+    for(int i = 0; i < STRIPES; i++) {
+        PIN_MutexInit(&stripes[i].lock);
+        stripes[i].lines = NULL;
+        stripes[i].pool = NULL;
+        stripes[i].used = 0;
+        stripes[i].hand = 0;
+        stripes[i].evictions = 0;
+    }
+
+    trace_bank_add_section("coherence", coherence_dump);
+    return 0;
+}
+
+int coherence_enabled()
+{
+    return enabled;
+}
+
+// Entry for a new line: a free one or, once the stripe is full, the first one
+// not referenced since the clock hand last passed, as if every cache dropped it.
+static LINE_ENTRY *take_entry(STRIPE *s)
+{
+    if(s->pool == NULL) {
+        s->pool = (LINE_ENTRY *) malloc(STRIPE_LINES * sizeof(LINE_ENTRY));
+        if(s->pool == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on coherence directory." << std::endl;
+            fail();
+        }
+    }
+
+    if(s->used < STRIPE_LINES) {
+        return &s->pool[s->used++];
+    }
+
+    while(s->pool[s->hand].referenced > 0) {
+        s->pool[s->hand].referenced = 0;
+        s->hand = (s->hand + 1) % STRIPE_LINES;
+    }
+
+    LINE_ENTRY *e = &s->pool[s->hand];
+    s->hand = (s->hand + 1) % STRIPE_LINES;
+    HASH_DEL(s->lines, e);
+    s->evictions++;
+    return e;
+}
+
+static LINE_ENTRY *get_line(STRIPE *s, UINT64 line)
+{
+    LINE_ENTRY *e;
+
+    HASH_FIND(hh, s->lines, &line, sizeof(UINT64), e);
+    if(e != NULL) {
+        e->referenced = 1;
+        return e;
+    }
+
+    e = take_entry(s);
+    memset(e, 0, sizeof(LINE_ENTRY));
+    e->line = line;
+    e->state = LINE_INVALID;
+    e->owner = INVALID_THREADID;
+    e->referenced = 1;
+    HASH_ADD(hh, s->lines, line, sizeof(UINT64), e);
+    return e;
+}
+
+// Details of tid on the line, NULL if it came after LINE_USERS others.
+static LINE_USER *get_user(LINE_ENTRY *e, THREADID tid)
+{
+    UINT64 bit = 1ULL << (tid % 64);
+
+    if((e->touched[tid / 64] & bit) != 0) {
+        for(int i = 0; i < e->total_users; i++) {
+            if(e->users[i].tid == tid) {
+                return &e->users[i];
+            }
+        }
+        return NULL;
+    }
+
+    e->touched[tid / 64] |= bit;
+    if(e->total_users >= LINE_USERS) {
+        return NULL;
+    }
+
+    LINE_USER *u = &e->users[e->total_users++];
+    u->tid = tid;
+    return u;
+}
+
+static int count_users(LINE_ENTRY *e)
+{
+    int total = 0;
+    for(int i = 0; i < SHARER_WORDS; i++) {
+        total += __builtin_popcountll(e->touched[i]);
+    }
+    return total;
+}
+
+static int is_sharer(LINE_ENTRY *e, THREADID tid)
+{
+    return (e->sharers[tid / 64] >> (tid % 64)) & 1;
+}
+
+// Number of copies held by threads other than tid.
+static int other_sharers(LINE_ENTRY *e, THREADID tid)
+{
+    int total = 0;
+    for(int i = 0; i < SHARER_WORDS; i++) {
+        total += __builtin_popcountll(e->sharers[i]);
+    }
+    return total - is_sharer(e, tid);
+}
+
+// Mark chunks [offset, offset + size) of a line, clipped to the line.
+static UINT64 offsets_mask(UINT32 offset, UINT32 size)
+{
+    UINT32 first = offset >> chunk_bits;
+    UINT32 last = (offset + (size > 0 ? size : 1) - 1) >> chunk_bits;
+    if(last >= OFFSET_BITS) {
+        last = OFFSET_BITS - 1;
+    }
+
+    UINT32 count = last - first + 1;
+    UINT64 bits = count >= 64 ? ~0ULL : ((1ULL << count) - 1);
+    return bits << first;
+}
+
+UINT32 coherence_access(THREADID tid, ADDRINT addr, UINT32 size, BOOL is_write)
+{
+    UINT64 line = (UINT64) addr >> line_bits;
+    UINT32 offset = (UINT32)(addr & ((1 << line_bits) - 1));
+    STRIPE *s = &stripes[line & (STRIPES - 1)];
+    THREAD_COHERENCE *t = &threads[tid];
+    UINT32 penalty = 0;
+
+    PIN_MutexLock(&s->lock);
+    LINE_ENTRY *e = get_line(s, line);
+
+    LINE_USER *u = get_user(e, tid);
+    if(u != NULL) {
+        u->offsets |= offsets_mask(offset, size);
+        u->reads += is_write ? 0 : 1;
+        u->writes += is_write ? 1 : 0;
+    }
+
+    if(is_write) {
+
+        int others = other_sharers(e, tid);
+        if(others > 0) {
+            // Someone else modified it, fetch it before invalidating.
+            if(e->state == LINE_MODIFIED && e->owner != tid) {
+                e->transfers++;
+                t->transfers++;
+                penalty += transfer_cost;
+            }
+            e->invalidations += others;
+            t->invalidations += others;
+            penalty += invalidate_cost;
+        }
+
+        memset(e->sharers, 0, sizeof(e->sharers));
+        e->state = LINE_MODIFIED;
+        e->owner = tid;
+    } else {
+        if(is_sharer(e, tid) == 0) {
+            if(e->state == LINE_MODIFIED) {
+                e->transfers++;
+                t->transfers++;
+                penalty += transfer_cost;
+            }
+            e->state = e->state == LINE_INVALID ? LINE_EXCLUSIVE : LINE_SHARED;
+            e->owner = e->state == LINE_EXCLUSIVE ? tid : INVALID_THREADID;
+        }
+    }
+    e->sharers[tid / 64] |= 1ULL << (tid % 64);
+
+    PIN_MutexUnlock(&s->lock);
+
+    t->penalty += penalty;
+    return penalty;
+}
+
+// True sharing if any two threads touched the same chunk.
+static int is_true_sharing(LINE_ENTRY *e)
+{
+    for(int i = 0; i < e->total_users; i++) {
+        for(int j = i + 1; j < e->total_users; j++) {
+            if((e->users[i].offsets & e->users[j].offsets) != 0) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void find_hot_lines()
+{
+    top_init(&hot, HOT_LINES);
+
+    for(int i = 0; i < STRIPES; i++) {
+        for(LINE_ENTRY *e = stripes[i].lines; e != NULL; e = (LINE_ENTRY *) e->hh.next) {
+            if(e->invalidations > 0) {
+                top_offer(&hot, e, e->invalidations);
+            }
+        }
+    }
+}
+
+void coherence_report()
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    find_hot_lines();
+    for(int i = 0; i < hot.total; i++) {
+        LINE_ENTRY *e = (LINE_ENTRY *) hot.items[i];
+        cerr << "[PINocchio] Hot line 0x" << hex << (e->line << line_bits) << dec << ": "
+             << e->invalidations << " invalidations, " << count_users(e) << " threads, "
+             << (is_true_sharing(e) > 0 ? "true" : "false") << " sharing" << std::endl;
+    }
+}
+
+void coherence_dump(OUT_BUFFER *b)
+{
+    char str[32];
+    UINT64 invalidations = 0;
+    UINT64 transfers = 0;
+    UINT64 evictions = 0;
+
+    find_hot_lines();
+    for(int i = 0; i < MAX_THREADS; i++) {
+        invalidations += threads[i].invalidations;
+        transfers += threads[i].transfers;
+    }
+    for(int i = 0; i < STRIPES; i++) {
+        evictions += stripes[i].evictions;
+    }
+
+    out_buffer_str(b, "{\n    \"invalidations\":");
+    out_buffer_u64(b, invalidations);
+    out_buffer_str(b, ", \"transfers\":");
+    out_buffer_u64(b, transfers);
+    out_buffer_str(b, ", \"offset-bytes\":");
+    out_buffer_u64(b, 1 << chunk_bits);
+    out_buffer_str(b, ", \"evictions\":");
+    out_buffer_u64(b, evictions);
+
+    out_buffer_str(b, ",\n    \"per-thread\": [");
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_COHERENCE *t = &threads[i];
+        if(t->invalidations == 0 && t->transfers == 0) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "\n      {\"pin-tid\":" : ",\n      {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        out_buffer_str(b, ", \"invalidations\":");
+        out_buffer_u64(b, t->invalidations);
+        out_buffer_str(b, ", \"transfers\":");
+        out_buffer_u64(b, t->transfers);
+        out_buffer_str(b, ", \"penalty\":");
+        out_buffer_u64(b, t->penalty);
+        out_buffer_char(b, '}');
+    }
+
+    out_buffer_str(b, "\n    ],\n    \"hot-lines\": [");
+    for(int i = 0; i < hot.total; i++) {
+        LINE_ENTRY *e = (LINE_ENTRY *) hot.items[i];
+
+        snprintf(str, sizeof(str), "\"0x%llx\"", (unsigned long long)(e->line << line_bits));
+        out_buffer_str(b, i > 0 ? ",\n      {\"line\":" : "\n      {\"line\":");
+        out_buffer_str(b, str);
+        out_buffer_str(b, ", \"invalidations\":");
+        out_buffer_u64(b, e->invalidations);
+        out_buffer_str(b, ", \"transfers\":");
+        out_buffer_u64(b, e->transfers);
+        out_buffer_str(b, ", \"sharing\":\"");
+        out_buffer_str(b, is_true_sharing(e) > 0 ? "true" : "false");
+        out_buffer_str(b, "\", \"total-threads\":");
+        out_buffer_u64(b, count_users(e));
+        out_buffer_str(b, ", \"threads\": [");
+
+        for(int j = 0; j < e->total_users; j++) {
+            LINE_USER *u = &e->users[j];
+
+            snprintf(str, sizeof(str), "\"%016llx\"", (unsigned long long) u->offsets);
+            out_buffer_str(b, j > 0 ? ", {\"pin-tid\":" : "{\"pin-tid\":");
+            out_buffer_u64(b, print_id(u->tid));
+            out_buffer_str(b, ", \"offsets\":");
+            out_buffer_str(b, str);
+            out_buffer_str(b, ", \"reads\":");
+            out_buffer_u64(b, u->reads);
+            out_buffer_str(b, ", \"writes\":");
+            out_buffer_u64(b, u->writes);
+            out_buffer_char(b, '}');
+        }
+        out_buffer_str(b, "]}");
+    }
+    out_buffer_str(b, "\n    ]\n  }");
+}
+
+void coherence_free()
+{
+    for(int i = 0; i < STRIPES; i++) {
+        HASH_CLEAR(hh, stripes[i].lines);
+        free(stripes[i].pool);
+        stripes[i].pool = NULL;
+        stripes[i].used = 0;
+    }
+    top_init(&hot, HOT_LINES);
+}
@@ -0,0 +1,52 @@
+/* coherence.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef COHERENCE_H_
+#define COHERENCE_H_
+
+/*
+MESI-style coherence directory (-coherence), tracking on cache line
+granularity which threads hold each line. Writing a line held by other
+threads invalidates them and reading a line modified by another thread
+transfers it, charging -coherence-invalidate and -coherence-transfer cycles
+to the accessing thread.
+
+Lines with the most invalidations are reported along with the offsets each
+thread touched: threads touching overlapping bytes are truly sharing data,
+disjoint offsets on the same line are false sharing.
+
+The directory is split in stripes, each one a hash with its own lock, so
+threads only contend when touching lines of the same stripe. Each stripe
+keeps a fixed pool of lines, allocated on first use, and once it's full a
+clock hand evicts a line not touched since its last pass, as if every cache
+dropped it. Offsets are kept for the first few threads of a line, later ones
+are only counted.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+// Parse coherence knobs. Returns 0 on success, -1 if invalid.
+int coherence_init();
+
+// Returns 1 if the coherence model is enabled.
+int coherence_enabled();
+
+// Access of size bytes on addr by tid, returning the penalty in cycles.
+UINT32 coherence_access(THREADID tid, ADDRINT addr, UINT32 size, BOOL is_write);
+
+// Print the hottest lines on stderr.
+void coherence_report();
+
+// Section writer of coherence statistics, see trace_bank_add_section.
+void coherence_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void coherence_free();
+
+#endif // COHERENCE_H_
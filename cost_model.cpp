@@ -0,0 +1,205 @@
+/* cost_model.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "cost_model.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+#define MAX_COST_ENTRIES 512
+#define MAX_COST_NAME 64
+
+typedef enum {
+    COST_OPCODE = 0,
+    COST_CATEGORY = 1,
+}   COST_TYPE;
+
+typedef struct {
+    COST_TYPE type;
+    char name[MAX_COST_NAME];
+    UINT32 weight;
+} COST_ENTRY;
+
+// Approximate latencies of a recent x86 core (Skylake-like).
+static const COST_ENTRY x86_table[] = {
+    // Integer multiplication and division
+    {COST_OPCODE, "IMUL", 3},
+    {COST_OPCODE, "MUL", 3},
+    {COST_OPCODE, "MULX", 4},
+    {COST_OPCODE, "DIV", 26},
+    {COST_OPCODE, "IDIV", 26},
+
+    // Scalar and packed floating point
+    {COST_OPCODE, "ADDSD", 4},
+    {COST_OPCODE, "ADDSS", 4},
+    {COST_OPCODE, "SUBSD", 4},
+    {COST_OPCODE, "SUBSS", 4},
+    {COST_OPCODE, "MULSD", 4},
+    {COST_OPCODE, "MULSS", 4},
+    {COST_OPCODE, "DIVSS", 11},
+    {COST_OPCODE, "DIVSD", 14},
+    {COST_OPCODE, "DIVPS", 11},
+    {COST_OPCODE, "DIVPD", 14},
+    {COST_OPCODE, "SQRTSS", 12},
+    {COST_OPCODE, "SQRTSD", 18},
+    {COST_OPCODE, "SQRTPS", 12},
+    {COST_OPCODE, "SQRTPD", 18},
+    {COST_OPCODE, "VDIVSS", 11},
+    {COST_OPCODE, "VDIVSD", 14},
+    {COST_OPCODE, "VDIVPS", 11},
+    {COST_OPCODE, "VDIVPD", 14},
+    {COST_OPCODE, "VSQRTSS", 12},
+    {COST_OPCODE, "VSQRTSD", 18},
+    {COST_OPCODE, "VSQRTPS", 12},
+    {COST_OPCODE, "VSQRTPD", 18},
+    {COST_OPCODE, "CVTSI2SD", 5},
+    {COST_OPCODE, "CVTTSD2SI", 6},
+    {COST_OPCODE, "FDIV", 15},
+    {COST_OPCODE, "FDIVP", 15},
+    {COST_OPCODE, "FSQRT", 21},
+
+    // Serializing and locked operations
+    {COST_OPCODE, "CPUID", 100},
+    {COST_OPCODE, "RDTSC", 25},
+    {COST_OPCODE, "RDTSCP", 32},
+    {COST_OPCODE, "MFENCE", 33},
+    {COST_OPCODE, "LFENCE", 4},
+    {COST_OPCODE, "SFENCE", 6},
+    {COST_OPCODE, "PAUSE", 140},
+    {COST_OPCODE, "XCHG", 18},
+    {COST_OPCODE, "CMPXCHG", 18},
+    {COST_OPCODE, "XADD", 18},
+
+    // Categories
+    {COST_CATEGORY, "SSE", 4},
+    {COST_CATEGORY, "AVX", 4},
+    {COST_CATEGORY, "AVX2", 4},
+    {COST_CATEGORY, "FMA", 4},
+    {COST_CATEGORY, "X87_ALU", 3},
+    {COST_CATEGORY, "SEMAPHORE", 18},
+    {COST_CATEGORY, "STRINGOP", 2},
+    {COST_CATEGORY, "SYSCALL", 100},
+    {COST_CATEGORY, "CALL", 2},
+    {COST_CATEGORY, "RET", 2},
+};
+
+static COST_ENTRY entries[MAX_COST_ENTRIES];
+static int total_entries;
+static UINT32 default_weight;
+
+static int add_entry(COST_TYPE type, const char *name, UINT32 weight)
+{
+    if(total_entries >= MAX_COST_ENTRIES) {
+        cerr << "[PINocchio] Error: Too many cost table entries, max is " << MAX_COST_ENTRIES << std::endl;
+        return -1;
+    }
+
+    COST_ENTRY *e = &entries[total_entries++];
+    e->type = type;
+    strncpy(e->name, name, MAX_COST_NAME - 1);
+    e->name[MAX_COST_NAME - 1] = '\0';
+    e->weight = weight;
+    return 0;
+}
+
+static int load_file(const char *filename)
+{
+    char line[256];
+    char kind[16];
+    char name[MAX_COST_NAME];
+    unsigned weight;
+    int number = 0;
+
+    FILE *f = fopen(filename, "r");
+    if(f == NULL) {
+        cerr << "[PINocchio] Error: Can't open cost table: " << filename << std::endl;
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        number++;
+
+        char *comment = strchr(line, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+
+        int fields = sscanf(line, "%15s %63s %u", kind, name, &weight);
+        if(fields <= 0) {
+            continue;
+        }
+
+        int ok = -1;
+        if(fields == 2 && strcmp(kind, "default") == 0 && sscanf(name, "%u", &weight) == 1) {
+            default_weight = weight;
+            ok = 0;
+        } else if(fields == 3 && strcmp(kind, "opcode") == 0) {
+            ok = add_entry(COST_OPCODE, name, weight);
+        } else if(fields == 3 && strcmp(kind, "category") == 0) {
+            ok = add_entry(COST_CATEGORY, name, weight);
+        }
+
+        if(ok < 0) {
+            cerr << "[PINocchio] Error: Invalid cost table entry on " << filename << ":" << number << std::endl;
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+int cost_model_init()
+{
+    total_entries = 0;
+    default_weight = 1;
+
+    const string &table = knob_cost_table.Value();
+    if(table == "") {
+        return 0;
+    }
+
+    if(table == "x86") {
+        for(unsigned i = 0; i < sizeof(x86_table) / sizeof(x86_table[0]); i++) {
+            entries[total_entries++] = x86_table[i];
+        }
+    } else if(load_file(table.c_str()) < 0) {
+        return -1;
+    }
+
+    cerr << "[PINocchio] Cost table " << table << " loaded, " << total_entries << " entries" << std::endl;
+    return 0;
+}
+
+static int find_entry(COST_TYPE type, const string &name)
+{
+    for(int i = 0; i < total_entries; i++) {
+        if(entries[i].type == type && name == entries[i].name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+UINT32 cost_model_weight(INS ins)
+{
+    if(total_entries == 0) {
+        return default_weight;
+    }
+
+    // Opcode is more specific, so it wins over category.
+    int e = find_entry(COST_OPCODE, OPCODE_StringShort(INS_Opcode(ins)));
+    if(e < 0) {
+        e = find_entry(COST_CATEGORY, CATEGORY_StringShort(INS_Category(ins)));
+    }
+
+    return e >= 0 ? entries[e].weight : default_weight;
+}
@@ -0,0 +1,36 @@
+/* cost_model.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef COST_MODEL_H_
+#define COST_MODEL_H_
+
+/*
+Per-instruction cost, in cycles. Weights are looked up by opcode and then by
+category when each instruction is instrumented, and handed to the handlers as
+an immediate, so the runtime cost is the same as counting instructions.
+
+-cost-table selects the table: empty (default) charges 1 per instruction,
+"x86" uses the built-in table for a modern x86 core and anything else is a
+file with one entry per line ('#' starts a comment):
+
+  opcode NAME WEIGHT        e.g. opcode DIV 26
+  category NAME WEIGHT      e.g. category SSE 4
+  default WEIGHT
+
+Names are the ones given by OPCODE_StringShort and CATEGORY_StringShort.
+*/
+
+#include "pin.H"
+
+// Load the table selected by -cost-table. Returns 0 on success, -1 otherwise.
+int cost_model_init();
+
+// Weight of a given instruction.
+UINT32 cost_model_weight(INS ins);
+
+#endif // COST_MODEL_H_
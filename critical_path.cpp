@@ -0,0 +1,416 @@
+/* critical_path.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "critical_path.h"
+#include "trace_bank.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <iostream>
+
+#define INITIAL_EDGES 64            // Edges allocated on the first wake up of a thread
+#define REPORT_OBJECTS 5            // Objects printed on stderr
+
+// Wake up edge, from waker at waker_time to the thread at time.
+typedef struct {
+    UINT64 time;
+    UINT64 blocked;                 // When the thread blocked
+    UINT64 waker_time;
+    UINT64 hold;                    // Since when the waker held a mutex, waker_time if not
+    THREADID waker;
+    void *object;
+    WAKE_CAUSE cause;
+} EDGE;
+
+typedef struct {
+    int registered;
+    UINT64 start;
+    UINT64 end;
+    THREADID creator;               // INVALID_THREADID for thread 0
+    UINT64 blocked;
+    int holding;                    // hold_since is set for the next wake up
+    UINT64 hold_since;
+
+    EDGE *edges;                    // In time order
+    int total_edges;
+    int max_edges;
+} NODE;
+
+// Piece of the path on tid during [begin, end]: handoff or critical section of
+// object, or plain running if object is NULL.
+typedef struct {
+    THREADID tid;
+    UINT64 begin;
+    UINT64 end;
+    void *object;                   // NULL for the start of a thread
+    WAKE_CAUSE cause;
+} SEGMENT;
+
+// Duration on the path attributed to a sync object.
+typedef struct _OBJECT_SHARE OBJECT_SHARE;
+struct _OBJECT_SHARE {
+    void *key;
+    WAKE_CAUSE cause;
+    UINT64 time;
+    UINT64 segments;
+
+    UT_hash_handle hh;
+};
+
+static int enabled;
+static NODE nodes[MAX_THREADS];
+
+static int computed;
+static UINT64 length;
+static SEGMENT *segments;
+static int total_segments;
+static OBJECT_SHARE *shares;
+
+void critical_path_init(int pram)
+{
+    enabled = pram > 0 && knob_critical_path.Value() ? 1 : 0;
+    computed = 0;
+    segments = NULL;
+    total_segments = 0;
+    shares = NULL;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        nodes[i].registered = 0;
+        nodes[i].edges = NULL;
+        nodes[i].total_edges = 0;
+        nodes[i].max_edges = 0;
+        nodes[i].holding = 0;
+    }
+
+    if(knob_critical_path.Value() && pram == 0) {
+        cerr << "[PINocchio] Warning: Critical path needs PRAM mode, ignoring it." << std::endl;
+    }
+    if(enabled > 0) {
+        trace_bank_add_section("critical-path", critical_path_dump);
+    }
+}
+
+int critical_path_enabled()
+{
+    return enabled;
+}
+
+void critical_path_create(THREADID tid, THREADID creator, UINT64 time)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    nodes[tid].registered = 1;
+    nodes[tid].start = time;
+    nodes[tid].end = time;
+    nodes[tid].creator = creator;
+    nodes[tid].total_edges = 0;
+}
+
+void critical_path_block(THREADID tid, UINT64 time)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    nodes[tid].blocked = time;
+}
+
+void critical_path_hold(THREADID tid, UINT64 since)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    nodes[tid].holding = 1;
+    nodes[tid].hold_since = since;
+}
+
+void critical_path_wake(THREADID tid, UINT64 time, THREADID waker, UINT64 waker_time,
+                        void *object, WAKE_CAUSE cause)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    NODE *n = &nodes[tid];
+    if(n->total_edges >= n->max_edges) {
+        n->max_edges = n->max_edges > 0 ? 2 * n->max_edges : INITIAL_EDGES;
+        n->edges = (EDGE *) realloc(n->edges, n->max_edges * sizeof(EDGE));
+        if(n->edges == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on critical path edges." << std::endl;
+            fail();
+        }
+    }
+
+    EDGE *e = &n->edges[n->total_edges++];
+    e->time = time;
+    e->blocked = n->blocked;
+    e->waker_time = waker_time;
+    e->hold = waker_time;
+    e->waker = waker;
+    e->object = object;
+    e->cause = cause;
+
+    NODE *w = &nodes[waker];
+    if(w->holding > 0 && w->hold_since <= waker_time) {
+        e->hold = w->hold_since;
+    }
+    w->holding = 0;
+}
+
+void critical_path_finish(THREADID tid, UINT64 time)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    nodes[tid].end = time;
+}
+
+static void add_segment(THREADID tid, UINT64 begin, UINT64 end, void *object, WAKE_CAUSE cause)
+{
+    static int max_segments = 0;
+
+    if(end <= begin) {
+        return;
+    }
+
+    if(total_segments >= max_segments) {
+        max_segments = max_segments > 0 ? 2 * max_segments : INITIAL_EDGES;
+        segments = (SEGMENT *) realloc(segments, max_segments * sizeof(SEGMENT));
+        if(segments == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on critical path segments." << std::endl;
+            fail();
+        }
+    }
+
+    SEGMENT *s = &segments[total_segments++];
+    s->tid = tid;
+    s->begin = begin;
+    s->end = end;
+    s->object = object;
+    s->cause = cause;
+
+    OBJECT_SHARE *o;
+    HASH_FIND_PTR(shares, &object, o);
+    if(o == NULL) {
+        o = (OBJECT_SHARE *) malloc(sizeof(OBJECT_SHARE));
+        o->key = object;
+        o->cause = cause;
+        o->time = 0;
+        o->segments = 0;
+        HASH_ADD_PTR(shares, key, o);
+    }
+    o->time += end - begin;
+    o->segments++;
+}
+
+// Index of the last edge before limit that happened up to time and was a real
+// wait, that is, the waker released the thread after it blocked. -1 if none.
+static int find_edge(NODE *n, int limit, UINT64 time)
+{
+    int low = 0;
+    int high = limit;
+
+    // First edge after time.
+    while(low < high) {
+        int mid = (low + high) / 2;
+        if(n->edges[mid].time <= time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // A waker behind the thread didn't delay it, skip it.
+    for(int i = low - 1; i >= 0; i--) {
+        if(n->edges[i].waker_time >= n->edges[i].blocked) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int compare_shares(OBJECT_SHARE *a, OBJECT_SHARE *b)
+{
+    if(a->time == b->time) {
+        return 0;
+    }
+    return a->time < b->time ? 1 : -1;
+}
+
+static void compute()
+{
+    static int limit[MAX_THREADS];
+    THREADID tid = INVALID_THREADID;
+
+    computed = 1;
+    length = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        limit[i] = nodes[i].total_edges;
+        if(nodes[i].registered > 0 && (tid == INVALID_THREADID || nodes[i].end > length)) {
+            tid = i;
+            length = nodes[i].end;
+        }
+    }
+
+    // Edges are only used once, going backwards, so the walk always ends.
+    UINT64 time = length;
+    EDGE *held = NULL;
+    while(tid != INVALID_THREADID && limit[tid] >= 0) {
+        NODE *n = &nodes[tid];
+
+        int e = find_edge(n, limit[tid], time);
+
+        // Critical section of the waker, clipped to its own wake up or start.
+        if(held != NULL) {
+            UINT64 begin = e >= 0 ? n->edges[e].time : n->start;
+            UINT64 since = held->hold > begin ? held->hold : begin;
+            add_segment(tid, since, time, held->object, held->cause);
+            time = since;
+            held = NULL;
+        }
+
+        if(e >= 0) {
+            EDGE *edge = &n->edges[e];
+            add_segment(tid, edge->time, time, NULL, CAUSE_NONE);
+            add_segment(tid, edge->waker_time, edge->time, edge->object, edge->cause);
+            held = edge->hold < edge->waker_time ? edge : NULL;
+            limit[tid] = e;
+            time = edge->waker_time;
+            tid = edge->waker;
+            continue;
+        }
+
+        add_segment(tid, n->start, time, NULL, CAUSE_NONE);
+        limit[tid] = -1;
+        time = n->start;
+        tid = n->creator;
+    }
+
+    // Walked backwards, present it in time order.
+    for(int i = 0, j = total_segments - 1; i < j; i++, j--) {
+        SEGMENT s = segments[i];
+        segments[i] = segments[j];
+        segments[j] = s;
+    }
+
+    HASH_SORT(shares, compare_shares);
+}
+
+static const char *segment_cause(void *object, WAKE_CAUSE cause)
+{
+    return object == NULL && cause == CAUSE_NONE ? "run" : wake_cause_name(cause);
+}
+
+static double share(UINT64 time)
+{
+    return length > 0 ? (double) time / length : 0;
+}
+
+void critical_path_report()
+{
+    if(enabled == 0) {
+        return;
+    }
+    if(computed == 0) {
+        compute();
+    }
+
+    cerr << "[PINocchio] Critical path: " << length << " instructions, " << total_segments << " segments" << std::endl;
+
+    int printed = 0;
+    for(OBJECT_SHARE *o = shares; o != NULL && printed < REPORT_OBJECTS; o = (OBJECT_SHARE *) o->hh.next) {
+        if(o->key == NULL) {
+            continue;
+        }
+        cerr << "[PINocchio]   " << wake_cause_name(o->cause) << " " << o->key << ": "
+             << 100 * share(o->time) << "% (" << o->segments << " segments)" << std::endl;
+        printed++;
+    }
+}
+
+static void dump_object(OUT_BUFFER *b, void *object)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "\"%p\"", object);
+    out_buffer_str(b, object != NULL ? str : "null");
+}
+
+void critical_path_dump(OUT_BUFFER *b)
+{
+    char str[32];
+
+    if(computed == 0) {
+        compute();
+    }
+
+    out_buffer_str(b, "{\n    \"length\":");
+    out_buffer_u64(b, length);
+
+    out_buffer_str(b, ",\n    \"segments\": [");
+    for(int i = 0; i < total_segments; i++) {
+        SEGMENT *s = &segments[i];
+
+        out_buffer_str(b, i > 0 ? ",\n      {" : "\n      {");
+        out_buffer_str(b, "\"pin-tid\":");
+        out_buffer_u64(b, print_id(s->tid));
+        out_buffer_str(b, ", \"begin\":");
+        out_buffer_u64(b, s->begin);
+        out_buffer_str(b, ", \"end\":");
+        out_buffer_u64(b, s->end);
+        out_buffer_str(b, ", \"object\":");
+        dump_object(b, s->object);
+        out_buffer_str(b, ", \"cause\":\"");
+        out_buffer_str(b, segment_cause(s->object, s->cause));
+        out_buffer_str(b, "\"}");
+    }
+
+    out_buffer_str(b, "\n    ],\n    \"objects\": [");
+    int first = 1;
+    for(OBJECT_SHARE *o = shares; o != NULL; o = (OBJECT_SHARE *) o->hh.next) {
+        out_buffer_str(b, first > 0 ? "\n      {" : ",\n      {");
+        first = 0;
+
+        out_buffer_str(b, "\"object\":");
+        dump_object(b, o->key);
+        out_buffer_str(b, ", \"cause\":\"");
+        out_buffer_str(b, segment_cause(o->key, o->cause));
+        out_buffer_str(b, "\", \"time\":");
+        out_buffer_u64(b, o->time);
+        out_buffer_str(b, ", \"segments\":");
+        out_buffer_u64(b, o->segments);
+        snprintf(str, sizeof(str), "%.6f", share(o->time));
+        out_buffer_str(b, ", \"share\":");
+        out_buffer_str(b, str);
+        out_buffer_char(b, '}');
+    }
+    out_buffer_str(b, "\n    ]\n  }");
+}
+
+void critical_path_free()
+{
+    OBJECT_SHARE *o, *tmp;
+    HASH_ITER(hh, shares, o, tmp) {
+        HASH_DEL(shares, o);
+        free(o);
+    }
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        free(nodes[i].edges);
+        nodes[i].edges = NULL;
+    }
+
+    free(segments);
+    segments = NULL;
+}
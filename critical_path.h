@@ -0,0 +1,64 @@
+/* critical_path.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef CRITICAL_PATH_H_
+#define CRITICAL_PATH_H_
+
+/*
+Critical path of the simulated execution. Every thread start (create) and
+every wake up (unlock->lock, post->wait, signal->wake, exit->join) is kept as
+a happens-before edge. At exit, the path is walked backwards from the thread
+that finished last: on each thread it goes back to the wake up that let it
+run, jumps to the waker, and so on until the start of thread 0. The path is
+split into segments, and the duration is attributed to the objects in it:
+an object is charged for the handoff, from its release to the wake up of the
+next thread, and for a mutex also the critical section of the releasing
+thread, since it took the mutex. The rest is plain running of each thread.
+
+Enabled by -critical-path. One edge is kept per wake up, so memory grows with
+the number of wake ups for the whole run. Only PRAM mode is handled, since
+the path is measured in instructions.
+*/
+
+#include "thread.h"
+#include "out_buffer.h"
+#include "pin.H"
+
+// Init structures, only enabled by its knob and if pram.
+void critical_path_init(int pram);
+
+// Returns 1 if the critical path is computed.
+int critical_path_enabled();
+
+// Thread tid created by creator at time.
+void critical_path_create(THREADID tid, THREADID creator, UINT64 time);
+
+// Thread tid blocked at time.
+void critical_path_block(THREADID tid, UINT64 time);
+
+// Thread tid releasing a mutex it took at since, right before waking the next
+// holder. Charged to the mutex as its critical section.
+void critical_path_hold(THREADID tid, UINT64 since);
+
+// Thread tid resumed at time, released by waker at waker_time through object.
+void critical_path_wake(THREADID tid, UINT64 time, THREADID waker, UINT64 waker_time,
+                        void *object, WAKE_CAUSE cause);
+
+// Thread tid finished at time.
+void critical_path_finish(THREADID tid, UINT64 time);
+
+// Compute the critical path and print a summary on stderr.
+void critical_path_report();
+
+// Section writer of the critical path, see trace_bank_add_section.
+void critical_path_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void critical_path_free();
+
+#endif // CRITICAL_PATH_H_
@@ -0,0 +1,392 @@
+/* synthetic_app.c
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+/*
+Parametric workload. Each thread runs a number of iterations, every one of
+them some compute followed by a sync operation, picked from a weighted mix
+of primitives. Usage:
+
+    synthetic_app THREADS [-i ITERATIONS] [-l LOCKS] [-c CS_LENGTH]
+                  [-w COMPUTE_LENGTH] [-s SHARED_PERCENT] [-r READ_PERCENT]
+                  [-m mutex=W,rwlock=W,sem=W,cond=W,barrier=W]
+
+Lengths are loop iterations, each one a memory access and some arithmetic.
+SHARED_PERCENT of the compute accesses go to an array shared by all threads,
+the rest to a private one. READ_PERCENT of the rwlock operations take the
+lock for reading. The cond primitive is a pool of credits guarded by a mutex
+and a condition variable, and the barrier is built on a mutex and a condition
+variable too, as there is no pthread_barrier support on the tool.
+
+Every thread goes through the same sequence of primitives, so all of them
+reach the same barriers, while the lock used is picked per thread. Each
+primitive guards its own data, as threads at different iterations hold
+different primitives at once.
+*/
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "stopwatch.h"
+
+#define SHARED_SIZE 4096
+#define PRIVATE_SIZE 4096
+#define SEM_VALUE 2
+
+enum { P_MUTEX, P_RWLOCK, P_SEM, P_COND, P_BARRIER, TOTAL_PRIMITIVES };
+
+static const char *primitive_names[TOTAL_PRIMITIVES] = {"mutex", "rwlock", "sem", "cond", "barrier"};
+
+typedef struct {
+    int threads;
+    int iterations;
+    int locks;
+    int cs_length;
+    int compute_length;
+    int shared_percent;
+    int read_percent;
+    int weights[TOTAL_PRIMITIVES];
+    int total_weight;
+} CONFIG;
+
+// Credits guarded by a mutex and a condition variable.
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int credits;
+} POOL;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int waiting;
+    int generation;
+} BARRIER;
+
+// Data protected by each lock of a primitive, exclusive sections increment
+// its counter.
+typedef struct {
+    int *data;
+    long *counters;
+} GUARDED;
+
+typedef struct {
+    int id;
+    unsigned int seed;
+    long exclusive[TOTAL_PRIMITIVES];   // Exclusive sections done, to check counters
+    long sum;
+} WORKER;
+
+static CONFIG config;
+
+static pthread_mutex_t *mutexes;
+static pthread_rwlock_t *rwlocks;
+static sem_t *sems;
+static POOL *pools;
+static BARRIER barrier;
+
+static GUARDED guarded[TOTAL_PRIMITIVES];
+
+static int shared_data[SHARED_SIZE];
+
+static int compute(WORKER *w, int *private_data, int length)
+{
+    int r = 0;
+
+    for(int i = 0; i < length; i++) {
+        int index = rand_r(&w->seed);
+        if(index % 100 < config.shared_percent) {
+            r += shared_data[(index / 100) % SHARED_SIZE]++;
+        } else {
+            r += private_data[(index / 100) % PRIVATE_SIZE]++;
+        }
+    }
+    return r;
+}
+
+static int critical_section(GUARDED *g, int lock, int length, int write)
+{
+    int r = 0;
+    int *data = &g->data[lock * config.cs_length];
+
+    for(int i = 0; i < length; i++) {
+        r += data[i];
+        if(write) {
+            data[i] = r;
+        }
+    }
+    return r;
+}
+
+static void barrier_wait(BARRIER *b)
+{
+    pthread_mutex_lock(&b->mutex);
+    int generation = b->generation;
+    if(++b->waiting == config.threads) {
+        b->waiting = 0;
+        b->generation++;
+        pthread_cond_broadcast(&b->cond);
+    } else {
+        while(generation == b->generation) {
+            pthread_cond_wait(&b->cond, &b->mutex);
+        }
+    }
+    pthread_mutex_unlock(&b->mutex);
+}
+
+// Same primitive for every thread on a given iteration.
+static int pick_primitive(int iteration)
+{
+    unsigned int x = ((unsigned int) iteration + 1) * 2654435761u;
+    int pick = (x >> 8) % config.total_weight;
+
+    for(int p = 0; p < TOTAL_PRIMITIVES; p++) {
+        if(pick < config.weights[p]) {
+            return p;
+        }
+        pick -= config.weights[p];
+    }
+    return P_MUTEX;
+}
+
+static void *worker(void *arg)
+{
+    WORKER *w = (WORKER *) arg;
+    int *private_data = (int *) calloc(PRIVATE_SIZE, sizeof(int));
+
+    for(int i = 0; i < config.iterations; i++) {
+        w->sum += compute(w, private_data, config.compute_length);
+
+        int lock = rand_r(&w->seed) % config.locks;
+        switch(pick_primitive(i)) {
+        case P_MUTEX:
+            pthread_mutex_lock(&mutexes[lock]);
+            w->sum += critical_section(&guarded[P_MUTEX], lock, config.cs_length, 1);
+            guarded[P_MUTEX].counters[lock]++;
+            pthread_mutex_unlock(&mutexes[lock]);
+            w->exclusive[P_MUTEX]++;
+            break;
+        case P_RWLOCK:
+            if(rand_r(&w->seed) % 100 < config.read_percent) {
+                pthread_rwlock_rdlock(&rwlocks[lock]);
+                w->sum += critical_section(&guarded[P_RWLOCK], lock, config.cs_length, 0);
+            } else {
+                pthread_rwlock_wrlock(&rwlocks[lock]);
+                w->sum += critical_section(&guarded[P_RWLOCK], lock, config.cs_length, 1);
+                guarded[P_RWLOCK].counters[lock]++;
+                w->exclusive[P_RWLOCK]++;
+            }
+            pthread_rwlock_unlock(&rwlocks[lock]);
+            break;
+        case P_SEM:
+            // Up to SEM_VALUE threads inside, only reading.
+            sem_wait(&sems[lock]);
+            w->sum += critical_section(&guarded[P_SEM], lock, config.cs_length, 0);
+            sem_post(&sems[lock]);
+            break;
+        case P_COND:
+            pthread_mutex_lock(&pools[lock].mutex);
+            while(pools[lock].credits == 0) {
+                pthread_cond_wait(&pools[lock].cond, &pools[lock].mutex);
+            }
+            pools[lock].credits--;
+            pthread_mutex_unlock(&pools[lock].mutex);
+
+            w->sum += compute(w, private_data, config.cs_length);
+
+            pthread_mutex_lock(&pools[lock].mutex);
+            pools[lock].credits++;
+            pthread_cond_signal(&pools[lock].cond);
+            pthread_mutex_unlock(&pools[lock].mutex);
+            break;
+        default:
+            barrier_wait(&barrier);
+            break;
+        }
+    }
+
+    free(private_data);
+    return NULL;
+}
+
+static int parse_mix(char *mix)
+{
+    memset(config.weights, 0, sizeof(config.weights));
+
+    for(char *entry = strtok(mix, ","); entry != NULL; entry = strtok(NULL, ",")) {
+        char *value = strchr(entry, '=');
+        if(value == NULL) {
+            return -1;
+        }
+        *value++ = '\0';
+
+        int p;
+        for(p = 0; p < TOTAL_PRIMITIVES; p++) {
+            if(strcmp(entry, primitive_names[p]) == 0) {
+                break;
+            }
+        }
+        if(p == TOTAL_PRIMITIVES || atoi(value) < 0) {
+            return -1;
+        }
+        config.weights[p] = atoi(value);
+    }
+    return 0;
+}
+
+static int usage(char *name)
+{
+    fprintf(stderr, "Usage: %s THREADS [-i ITERATIONS] [-l LOCKS] [-c CS_LENGTH] [-w COMPUTE_LENGTH]\n"
+            "       [-s SHARED_PERCENT] [-r READ_PERCENT] [-m mutex=W,rwlock=W,sem=W,cond=W,barrier=W]\n", name);
+    return 4;
+}
+
+int main(int argc, char **argv)
+{
+    stopwatch_start();
+    int i, opt;
+
+    config.threads = 2;
+    config.iterations = 1000;
+    config.locks = 4;
+    config.cs_length = 100;
+    config.compute_length = 1000;
+    config.shared_percent = 10;
+    config.read_percent = 80;
+    for(i = 0; i < TOTAL_PRIMITIVES; i++) {
+        config.weights[i] = 1;
+    }
+
+    while((opt = getopt(argc, argv, "i:l:c:w:s:r:m:")) != -1) {
+        switch(opt) {
+        case 'i': config.iterations = atoi(optarg); break;
+        case 'l': config.locks = atoi(optarg); break;
+        case 'c': config.cs_length = atoi(optarg); break;
+        case 'w': config.compute_length = atoi(optarg); break;
+        case 's': config.shared_percent = atoi(optarg); break;
+        case 'r': config.read_percent = atoi(optarg); break;
+        case 'm':
+            if(parse_mix(optarg) < 0) {
+                return usage(argv[0]);
+            }
+            break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+
+    if(optind < argc) {
+        config.threads = atoi(argv[optind]);
+    }
+
+    config.total_weight = 0;
+    for(i = 0; i < TOTAL_PRIMITIVES; i++) {
+        config.total_weight += config.weights[i];
+    }
+
+    if(config.threads < 1 || config.locks < 1 || config.iterations < 0 || config.cs_length < 0 ||
+            config.compute_length < 0 || config.total_weight == 0) {
+        return usage(argv[0]);
+    }
+
+    printf("threads %d, iterations %d, locks %d, cs %d, compute %d, shared %d%%, read %d%%, mix",
+           config.threads, config.iterations, config.locks, config.cs_length, config.compute_length,
+           config.shared_percent, config.read_percent);
+    for(i = 0; i < TOTAL_PRIMITIVES; i++) {
+        printf(" %s=%d", primitive_names[i], config.weights[i]);
+    }
+    printf("\n");
+
+    mutexes = (pthread_mutex_t *) malloc(config.locks * sizeof(pthread_mutex_t));
+    rwlocks = (pthread_rwlock_t *) malloc(config.locks * sizeof(pthread_rwlock_t));
+    sems = (sem_t *) malloc(config.locks * sizeof(sem_t));
+    pools = (POOL *) malloc(config.locks * sizeof(POOL));
+    for(i = P_MUTEX; i <= P_SEM; i++) {
+        guarded[i].data = (int *) calloc(config.locks * config.cs_length + 1, sizeof(int));
+        guarded[i].counters = (long *) calloc(config.locks, sizeof(long));
+    }
+
+    for(i = 0; i < config.locks; i++) {
+        if(pthread_mutex_init(&mutexes[i], NULL) || pthread_rwlock_init(&rwlocks[i], NULL) ||
+                sem_init(&sems[i], 0, SEM_VALUE) || pthread_mutex_init(&pools[i].mutex, NULL) ||
+                pthread_cond_init(&pools[i].cond, NULL)) {
+            fprintf(stderr, "error initializing locks");
+            return 3;
+        }
+        // Half the threads can hold a credit at once.
+        pools[i].credits = config.threads > 1 ? config.threads / 2 : 1;
+    }
+
+    pthread_mutex_init(&barrier.mutex, NULL);
+    pthread_cond_init(&barrier.cond, NULL);
+    barrier.waiting = 0;
+    barrier.generation = 0;
+
+    WORKER *workers = (WORKER *) calloc(config.threads, sizeof(WORKER));
+    pthread_t *worker_threads = (pthread_t *) malloc(config.threads * sizeof(pthread_t));
+
+    for(i = 0; i < config.threads; i++) {
+        workers[i].id = i;
+        workers[i].seed = i + 1;
+        if(pthread_create(&worker_threads[i], NULL, worker, &workers[i])) {
+            fprintf(stderr, "Error creating thread\n");
+            return 1;
+        }
+    }
+
+    for(i = 0; i < config.threads; i++) {
+        fprintf(stdout, "JOINING THREAD\n");
+        if(pthread_join(worker_threads[i], NULL)) {
+            fprintf(stderr, "Error joining thread\n");
+            return 2;
+        }
+    }
+
+    for(i = 0; i < config.locks; i++) {
+        pthread_mutex_destroy(&mutexes[i]);
+        pthread_rwlock_destroy(&rwlocks[i]);
+        sem_destroy(&sems[i]);
+        pthread_mutex_destroy(&pools[i].mutex);
+        pthread_cond_destroy(&pools[i].cond);
+    }
+    pthread_mutex_destroy(&barrier.mutex);
+    pthread_cond_destroy(&barrier.cond);
+
+    // Lost updates mean a lock didn't hold.
+    for(int p = P_MUTEX; p <= P_RWLOCK; p++) {
+        long counted = 0, exclusive = 0;
+        for(i = 0; i < config.locks; i++) {
+            counted += guarded[p].counters[i];
+        }
+        for(i = 0; i < config.threads; i++) {
+            exclusive += workers[i].exclusive[p];
+        }
+        if(counted != exclusive) {
+            fprintf(stderr, "Internal Error: %s result (%ld) different than expected (%ld)",
+                    primitive_names[p], counted, exclusive);
+            return 3;
+        }
+    }
+
+    printf("All threads joined.\n");
+
+    free(workers);
+    free(worker_threads);
+    free(mutexes);
+    free(rwlocks);
+    free(sems);
+    free(pools);
+    for(i = P_MUTEX; i <= P_SEM; i++) {
+        free(guarded[i].data);
+        free(guarded[i].counters);
+    }
+    stopwatch_stop();
+    return 0;
+}
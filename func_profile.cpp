@@ -0,0 +1,321 @@
+/* func_profile.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "func_profile.h"
+#include "trace_bank.h"
+#include "thread.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define UNKNOWN_FUNCTION 0          // Id of code outside any known routine
+#define INITIAL_FUNCTIONS 256
+
+typedef struct _FUNCTION FUNCTION;
+struct _FUNCTION {
+    ADDRINT address;
+
+    UT_hash_handle hh;
+
+    UINT32 id;
+    char *name;
+    char *image;
+};
+
+typedef struct {
+    UINT64 *counts;                 // Indexed by function id
+    UINT32 size;
+    UINT64 total;
+} THREAD_PROFILE;
+
+// Function and its instructions, used for sorting.
+typedef struct {
+    UINT32 id;
+    UINT64 count;
+} ENTRY;
+
+static int enabled;
+static int top;
+
+static FUNCTION *by_address;
+static FUNCTION **by_id;
+static UINT32 total_functions;
+static UINT32 max_functions;
+
+static THREAD_PROFILE threads[MAX_THREADS];
+
+static FUNCTION *add_function(ADDRINT address, const char *name, const char *image)
+{
+    if(total_functions >= max_functions) {
+        max_functions = max_functions > 0 ? 2 * max_functions : INITIAL_FUNCTIONS;
+        by_id = (FUNCTION **) realloc(by_id, max_functions * sizeof(FUNCTION *));
+        if(by_id == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on function profile." << std::endl;
+            fail();
+        }
+    }
+
+    FUNCTION *f = (FUNCTION *) malloc(sizeof(FUNCTION));
+    if(f == NULL) {
+        cerr << "[PINocchio] Error: Out of memory on function profile." << std::endl;
+        fail();
+    }
+    f->address = address;
+    f->id = total_functions++;
+    f->name = strdup(name);
+    f->image = strdup(image);
+    by_id[f->id] = f;
+    HASH_ADD(hh, by_address, address, sizeof(ADDRINT), f);
+    return f;
+}
+
+int func_profile_init()
+{
+    enabled = knob_profile.Value() ? 1 : 0;
+    memset(threads, 0, sizeof(threads));
+    by_address = NULL;
+    by_id = NULL;
+    total_functions = 0;
+    max_functions = 0;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    top = knob_profile_top.Value();
+    if(top <= 0) {
+        cerr << "[PINocchio] Error: Profile top should be positive: " << top << std::endl;
+        return -1;
+    }
+
+    // Id 0 has no address, it's never found on the hash.
+    add_function(0, "[unknown]", "");
+    HASH_DEL(by_address, by_id[UNKNOWN_FUNCTION]);
+
+    trace_bank_add_section("profile", func_profile_dump);
+    return 0;
+}
+
+int func_profile_enabled()
+{
+    return enabled;
+}
+
+UINT32 func_profile_id(INS ins)
+{
+    RTN rtn = INS_Rtn(ins);
+    if(!RTN_Valid(rtn)) {
+        return UNKNOWN_FUNCTION;
+    }
+
+    // Instrumentation is serialized by Pin, no lock needed.
+    ADDRINT address = RTN_Address(rtn);
+    FUNCTION *f;
+    HASH_FIND(hh, by_address, &address, sizeof(ADDRINT), f);
+    if(f != NULL) {
+        return f->id;
+    }
+
+    IMG img = SEC_Img(RTN_Sec(rtn));
+    f = add_function(address, RTN_Name(rtn).c_str(), IMG_Valid(img) ? IMG_Name(img).c_str() : "");
+    return f->id;
+}
+
+void func_profile_charge(THREADID tid, UINT32 id, UINT32 weight)
+{
+    THREAD_PROFILE *t = &threads[tid];
+
+    // Only the thread itself touches its counters.
+    if(id >= t->size) {
+        UINT32 size = t->size > 0 ? 2 * t->size : INITIAL_FUNCTIONS;
+        while(size <= id) {
+            size *= 2;
+        }
+
+        t->counts = (UINT64 *) realloc(t->counts, size * sizeof(UINT64));
+        if(t->counts == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on function profile." << std::endl;
+            fail();
+        }
+        memset(&t->counts[t->size], 0, (size - t->size) * sizeof(UINT64));
+        t->size = size;
+    }
+
+    t->counts[id] += weight;
+    t->total += weight;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    const ENTRY *x = (const ENTRY *) a;
+    const ENTRY *y = (const ENTRY *) b;
+
+    if(x->count == y->count) {
+        return x->id < y->id ? -1 : (x->id > y->id ? 1 : 0);
+    }
+    return x->count > y->count ? -1 : 1;
+}
+
+// Fill entries with the functions of a thread, or of all if tid is invalid,
+// sorted by instructions. Returns how many were executed at all.
+static int sort_functions(ENTRY *entries, THREADID tid)
+{
+    int used = 0;
+    int first = tid != INVALID_THREADID ? (int) tid : 0;
+    int last = tid != INVALID_THREADID ? (int) tid : MAX_THREADS - 1;
+
+    for(UINT32 id = 0; id < total_functions; id++) {
+        entries[id].id = id;
+        entries[id].count = 0;
+    }
+    for(int i = first; i <= last; i++) {
+        for(UINT32 id = 0; id < threads[i].size && id < total_functions; id++) {
+            entries[id].count += threads[i].counts[id];
+        }
+    }
+
+    // Executed ones first, in place.
+    for(UINT32 id = 0; id < total_functions; id++) {
+        if(entries[id].count > 0) {
+            entries[used++] = entries[id];
+        }
+    }
+
+    qsort(entries, used, sizeof(ENTRY), compare_entries);
+    return used;
+}
+
+static UINT64 total_instructions()
+{
+    UINT64 total = 0;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        total += threads[i].total;
+    }
+    return total;
+}
+
+static double share(UINT64 count, UINT64 total)
+{
+    return total > 0 ? (double) count / total : 0;
+}
+
+void func_profile_report()
+{
+    if(enabled == 0 || total_functions == 0) {
+        return;
+    }
+
+    ENTRY *entries = (ENTRY *) malloc(total_functions * sizeof(ENTRY));
+    if(entries == NULL) {
+        cerr << "[PINocchio] Error: Out of memory on function profile." << std::endl;
+        fail();
+    }
+    int used = sort_functions(entries, INVALID_THREADID);
+    UINT64 total = total_instructions();
+
+    cerr << "[PINocchio] Profile: " << total << " instructions on " << used << " functions" << std::endl;
+    for(int i = 0; i < used && i < top; i++) {
+        FUNCTION *f = by_id[entries[i].id];
+        cerr << "[PINocchio]   " << 100 * share(entries[i].count, total) << "% " << f->name
+             << " (" << entries[i].count << ")" << std::endl;
+    }
+    free(entries);
+}
+
+// Write the top functions on entries as a list.
+static void dump_entries(OUT_BUFFER *b, ENTRY *entries, int used, UINT64 total, const char *sep)
+{
+    char str[32];
+
+    out_buffer_char(b, '[');
+    for(int i = 0; i < used && i < top; i++) {
+        FUNCTION *f = by_id[entries[i].id];
+
+        out_buffer_str(b, i > 0 ? "," : "");
+        out_buffer_str(b, sep);
+        out_buffer_str(b, "{\"function\":\"");
+        out_buffer_escaped(b, f->name);
+        out_buffer_str(b, "\", \"image\":\"");
+        out_buffer_escaped(b, f->image);
+        out_buffer_str(b, "\", \"instructions\":");
+        out_buffer_u64(b, entries[i].count);
+        snprintf(str, sizeof(str), "%.6f", share(entries[i].count, total));
+        out_buffer_str(b, ", \"share\":");
+        out_buffer_str(b, str);
+        out_buffer_char(b, '}');
+    }
+    out_buffer_char(b, ']');
+}
+
+void func_profile_dump(OUT_BUFFER *b)
+{
+    ENTRY *entries = (ENTRY *) malloc((total_functions + 1) * sizeof(ENTRY));
+    if(entries == NULL) {
+        cerr << "[PINocchio] Error: Out of memory on function profile." << std::endl;
+        fail();
+    }
+    UINT64 total = total_instructions();
+
+    out_buffer_str(b, "{\n    \"instructions\":");
+    out_buffer_u64(b, total);
+    out_buffer_str(b, ", \"functions\":");
+    out_buffer_u64(b, total_functions);
+
+    out_buffer_str(b, ",\n    \"flat\": ");
+    int used = sort_functions(entries, INVALID_THREADID);
+    dump_entries(b, entries, used, total, "\n      ");
+
+    out_buffer_str(b, ",\n    \"per-thread\": [");
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_PROFILE *t = &threads[i];
+        if(t->total == 0) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "\n      {\"pin-tid\":" : ",\n      {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        out_buffer_str(b, ", \"instructions\":");
+        out_buffer_u64(b, t->total);
+        out_buffer_str(b, ", \"top\": ");
+        used = sort_functions(entries, i);
+        dump_entries(b, entries, used, t->total, "\n        ");
+        out_buffer_char(b, '}');
+    }
+    out_buffer_str(b, "\n    ]\n  }");
+
+    free(entries);
+}
+
+void func_profile_free()
+{
+    FUNCTION *f, *tmp;
+    HASH_ITER(hh, by_address, f, tmp) {
+        HASH_DEL(by_address, f);
+    }
+
+    for(UINT32 i = 0; i < total_functions; i++) {
+        free(by_id[i]->name);
+        free(by_id[i]->image);
+        free(by_id[i]);
+    }
+    free(by_id);
+    by_id = NULL;
+    total_functions = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        free(threads[i].counts);
+        threads[i].counts = NULL;
+        threads[i].size = 0;
+    }
+}
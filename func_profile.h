@@ -0,0 +1,48 @@
+/* func_profile.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef FUNC_PROFILE_H_
+#define FUNC_PROFILE_H_
+
+/*
+Per-function profile in simulated instructions (-profile), like gprof but on
+PRAM time: only executed instructions are counted, so time waiting on locks
+or for other threads doesn't show up.
+
+Each basic block is mapped to the function holding it when instrumented,
+and its weight (as given by the cost model) is added to that function on
+the executing thread. Threads only touch their own counters, so no lock is
+taken while running. At exit, the top -profile-top functions are reported,
+for the whole execution and per thread.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+// Parse profile knobs. Returns 0 on success, -1 if invalid.
+int func_profile_init();
+
+// Returns 1 if the profiler is enabled.
+int func_profile_enabled();
+
+// Function id of an instruction, registering its function if new.
+UINT32 func_profile_id(INS ins);
+
+// Add weight instructions executed by tid on function id.
+void func_profile_charge(THREADID tid, UINT32 id, UINT32 weight);
+
+// Print the flat profile on stderr.
+void func_profile_report();
+
+// Section writer of the profiles, see trace_bank_add_section.
+void func_profile_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void func_profile_free();
+
+#endif // FUNC_PROFILE_H_
@@ -13,6 +13,37 @@
 KNOB<string> knob_output_file(KNOB_MODE_WRITEONCE, "pintool", "o", DEFAULT_OUTPUT_FILE, "specify output filename");
 KNOB<BOOL> knob_time_based(KNOB_MODE_WRITEONCE, "pintool", "t", DEFAULT_TIME_BASED, "perform time-based evaluation (no-pram)");
 KNOB<int> knob_sync_frenquency(KNOB_MODE_WRITEONCE, "pintool", "p", DEFAULT_SYNC_PERIOD, "only sync on a given frenquency");
+KNOB<string> knob_output_format(KNOB_MODE_WRITEONCE, "pintool", "f", DEFAULT_OUTPUT_FORMAT, "output format: json, binary or chrome");
+KNOB<BOOL> knob_stats_only(KNOB_MODE_WRITEONCE, "pintool", "stats-only", DEFAULT_STATS_ONLY, "only keep per-thread totals, output a summary");
+KNOB<string> knob_time_unit(KNOB_MODE_WRITEONCE, "pintool", "u", DEFAULT_TIME_UNIT, "time-based unit: ns, us or ms");
+KNOB<string> knob_speedup_region(KNOB_MODE_WRITEONCE, "pintool", "speedup-region", DEFAULT_SPEEDUP_REGION, "virtual speedup region: func:NAME, line:FILE:LINE or addr:START-END");
+KNOB<int> knob_speedup(KNOB_MODE_WRITEONCE, "pintool", "speedup", DEFAULT_SPEEDUP, "virtual speedup of the region, in percent");
+KNOB<string> knob_cost_table(KNOB_MODE_WRITEONCE, "pintool", "cost-table", DEFAULT_COST_TABLE, "instruction costs: x86 (built-in) or a cost table file");
+KNOB<BOOL> knob_cache(KNOB_MODE_WRITEONCE, "pintool", "cache", DEFAULT_CACHE, "simulate caches, charging misses");
+KNOB<int> knob_cache_line(KNOB_MODE_WRITEONCE, "pintool", "cache-line", DEFAULT_CACHE_LINE, "cache line size in bytes");
+KNOB<string> knob_cache_l1(KNOB_MODE_WRITEONCE, "pintool", "cache-l1", DEFAULT_CACHE_L1, "private L1 cache, SIZE_KB:ASSOC:LATENCY");
+KNOB<string> knob_cache_l2(KNOB_MODE_WRITEONCE, "pintool", "cache-l2", DEFAULT_CACHE_L2, "private L2 cache, SIZE_KB:ASSOC:LATENCY");
+KNOB<string> knob_cache_llc(KNOB_MODE_WRITEONCE, "pintool", "cache-llc", DEFAULT_CACHE_LLC, "shared last level cache, SIZE_KB:ASSOC:LATENCY");
+KNOB<int> knob_cache_memory(KNOB_MODE_WRITEONCE, "pintool", "cache-memory", DEFAULT_CACHE_MEMORY, "memory latency in cycles");
+KNOB<BOOL> knob_coherence(KNOB_MODE_WRITEONCE, "pintool", "coherence", DEFAULT_COHERENCE, "simulate cache coherence, reporting shared lines");
+KNOB<int> knob_coherence_invalidate(KNOB_MODE_WRITEONCE, "pintool", "coherence-invalidate", DEFAULT_COHERENCE_INVALIDATE, "cycles to invalidate other copies on a write");
+KNOB<int> knob_coherence_transfer(KNOB_MODE_WRITEONCE, "pintool", "coherence-transfer", DEFAULT_COHERENCE_TRANSFER, "cycles to fetch a line modified by another thread");
+KNOB<int> knob_bandwidth(KNOB_MODE_WRITEONCE, "pintool", "bandwidth", DEFAULT_BANDWIDTH, "memory bandwidth budget in bytes per cycle, 0 to disable");
+KNOB<int> knob_bandwidth_window(KNOB_MODE_WRITEONCE, "pintool", "bandwidth-window", DEFAULT_BANDWIDTH_WINDOW, "cycles per bandwidth window");
+KNOB<string> knob_sync_cost(KNOB_MODE_WRITEONCE, "pintool", "sync-cost", DEFAULT_SYNC_COST, "cost of sync calls: default (built-in) or a sync cost table file");
+KNOB<int> knob_numa(KNOB_MODE_WRITEONCE, "pintool", "numa", DEFAULT_NUMA, "number of NUMA nodes, 0 to disable");
+KNOB<int> knob_numa_page(KNOB_MODE_WRITEONCE, "pintool", "numa-page", DEFAULT_NUMA_PAGE, "NUMA page size in bytes");
+KNOB<int> knob_numa_remote(KNOB_MODE_WRITEONCE, "pintool", "numa-remote", DEFAULT_NUMA_REMOTE, "extra cycles of a remote NUMA access");
+KNOB<BOOL> knob_profile(KNOB_MODE_WRITEONCE, "pintool", "profile", DEFAULT_PROFILE, "profile simulated instructions per function");
+KNOB<int> knob_profile_top(KNOB_MODE_WRITEONCE, "pintool", "profile-top", DEFAULT_PROFILE_TOP, "functions reported by the profile");
+KNOB<string> knob_offcpu(KNOB_MODE_WRITEONCE, "pintool", "offcpu", DEFAULT_OFFCPU, "write blocked time per call stack, folded, to this file");
+KNOB<bool> knob_self_profile(KNOB_MODE_WRITEONCE, "pintool", "self-profile", DEFAULT_SELF_PROFILE, "print where the tool itself spends time at exit");
+KNOB<string> knob_telemetry(KNOB_MODE_WRITEONCE, "pintool", "telemetry", DEFAULT_TELEMETRY, "publish progress snapshots to this file, or unix:PATH socket");
+KNOB<int> knob_telemetry_period(KNOB_MODE_WRITEONCE, "pintool", "telemetry-period", DEFAULT_TELEMETRY_PERIOD, "seconds between telemetry snapshots");
+KNOB<string> knob_record(KNOB_MODE_WRITEONCE, "pintool", "record", DEFAULT_RECORD, "record sync events to this file, for pinocchio-replay");
+KNOB<int> knob_sample_window(KNOB_MODE_WRITEONCE, "pintool", "sample-window", DEFAULT_SAMPLE_WINDOW, "cycles simulated in detail per sampling period");
+KNOB<int> knob_sample_interval(KNOB_MODE_WRITEONCE, "pintool", "sample-interval", DEFAULT_SAMPLE_INTERVAL, "cycles fast-forwarded between sample windows");
+KNOB<BOOL> knob_critical_path(KNOB_MODE_WRITEONCE, "pintool", "critical-path", DEFAULT_CRITICAL_PATH, "compute the critical path at exit");
 
 void knob_welcome()
 {
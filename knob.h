@@ -14,6 +14,37 @@
 #define DEFAULT_OUTPUT_FILE "trace.json"
 #define DEFAULT_TIME_BASED "0"
 #define DEFAULT_SYNC_PERIOD "1"
+#define DEFAULT_OUTPUT_FORMAT "json"
+#define DEFAULT_STATS_ONLY "0"
+#define DEFAULT_TIME_UNIT "ns"
+#define DEFAULT_SPEEDUP_REGION ""
+#define DEFAULT_SPEEDUP "0"
+#define DEFAULT_COST_TABLE ""
+#define DEFAULT_CACHE "0"
+#define DEFAULT_CACHE_LINE "64"
+#define DEFAULT_CACHE_L1 "32:8:4"
+#define DEFAULT_CACHE_L2 "256:4:12"
+#define DEFAULT_CACHE_LLC "8192:16:40"
+#define DEFAULT_CACHE_MEMORY "200"
+#define DEFAULT_COHERENCE "0"
+#define DEFAULT_COHERENCE_INVALIDATE "30"
+#define DEFAULT_COHERENCE_TRANSFER "60"
+#define DEFAULT_BANDWIDTH "0"
+#define DEFAULT_BANDWIDTH_WINDOW "1000"
+#define DEFAULT_SYNC_COST ""
+#define DEFAULT_NUMA "0"
+#define DEFAULT_NUMA_PAGE "4096"
+#define DEFAULT_NUMA_REMOTE "100"
+#define DEFAULT_PROFILE "0"
+#define DEFAULT_PROFILE_TOP "10"
+#define DEFAULT_OFFCPU ""
+#define DEFAULT_SELF_PROFILE "0"
+#define DEFAULT_TELEMETRY ""
+#define DEFAULT_TELEMETRY_PERIOD "5"
+#define DEFAULT_RECORD ""
+#define DEFAULT_SAMPLE_WINDOW "0"
+#define DEFAULT_SAMPLE_INTERVAL "0"
+#define DEFAULT_CRITICAL_PATH "0"
 
 void knob_welcome();
 INT32 knob_usage();
@@ -23,5 +54,36 @@ INT32 knob_usage();
 extern KNOB<string> knob_output_file;
 extern KNOB<bool> knob_time_based;
 extern KNOB<int> knob_sync_frenquency;
+extern KNOB<string> knob_output_format;
+extern KNOB<bool> knob_stats_only;
+extern KNOB<string> knob_time_unit;
+extern KNOB<string> knob_speedup_region;
+extern KNOB<int> knob_speedup;
+extern KNOB<string> knob_cost_table;
+extern KNOB<bool> knob_cache;
+extern KNOB<int> knob_cache_line;
+extern KNOB<string> knob_cache_l1;
+extern KNOB<string> knob_cache_l2;
+extern KNOB<string> knob_cache_llc;
+extern KNOB<int> knob_cache_memory;
+extern KNOB<bool> knob_coherence;
+extern KNOB<int> knob_coherence_invalidate;
+extern KNOB<int> knob_coherence_transfer;
+extern KNOB<int> knob_bandwidth;
+extern KNOB<int> knob_bandwidth_window;
+extern KNOB<string> knob_sync_cost;
+extern KNOB<int> knob_numa;
+extern KNOB<int> knob_numa_page;
+extern KNOB<int> knob_numa_remote;
+extern KNOB<bool> knob_profile;
+extern KNOB<int> knob_profile_top;
+extern KNOB<string> knob_offcpu;
+extern KNOB<bool> knob_self_profile;
+extern KNOB<string> knob_telemetry;
+extern KNOB<int> knob_telemetry_period;
+extern KNOB<string> knob_record;
+extern KNOB<int> knob_sample_window;
+extern KNOB<int> knob_sample_interval;
+extern KNOB<bool> knob_critical_path;
 
 #endif // KNOB_H_
@@ -8,6 +8,7 @@
 
 #include <iostream>
 #include "lock_hash.h"
+#include "critical_path.h"
 #include "log.h"
 #include "pin.H"
 
@@ -22,6 +23,7 @@ typedef struct _MUTEX_ENTRY MUTEX_ENTRY;
 struct _MUTEX_ENTRY {
     void *key;
     LOCK_STATUS status;             // Current status of mutex
+    UINT64 acquired;                // When the current holder took it
 
     UT_hash_handle hh;
 
@@ -108,6 +110,7 @@ static void initialize_mutex(MUTEX_ENTRY *s, void *key)
 {
     s->key = key;
     s->status = M_UNLOCKED;
+    s->acquired = 0;
     s->locked = NULL;
 }
 
@@ -199,6 +202,7 @@ void handle_lock(void *key, THREADID tid)
     if(s->status == M_UNLOCKED) {
         // If unlocked, first to come, just lock.
         s->status = M_LOCKED;
+        s->acquired = all_threads[tid].ins_count;
         return;
     }
 
@@ -209,13 +213,14 @@ void handle_lock(void *key, THREADID tid)
     return;
 }
 
-int handle_try_lock(void *key)
+int handle_try_lock(void *key, THREADID tid)
 {
     MUTEX_ENTRY *s = get_mutex_entry(key);
-    handle_no_mutex(s, key);
+    s = handle_no_mutex(s, key);
 
     if(s->status == M_UNLOCKED) {
         s->status = M_LOCKED;
+        s->acquired = all_threads[tid].ins_count;
         return 0;
     }
     return 1;
@@ -228,8 +233,10 @@ void handle_unlock(void *key, THREADID tid)
 
     if(s->locked != NULL) {
         s->status = M_LOCKED;
-        thread_unlock(s->locked, &all_threads[tid]);
+        critical_path_hold(tid, s->acquired);
+        thread_unlock(s->locked, &all_threads[tid], key, CAUSE_MUTEX);
 
+        s->acquired = s->locked->ins_count;
         s->locked = s->locked->next_lock;
         return;
     }
@@ -341,7 +348,7 @@ void handle_semaphore_post(void *key, THREADID tid)
     fail_on_no_semaphore(s, key);
 
     if(s->locked != NULL) {
-        thread_unlock(s->locked, &all_threads[tid]);
+        thread_unlock(s->locked, &all_threads[tid], key, CAUSE_SEMAPHORE);
         s->locked = s->locked->next_lock;
     }
 
@@ -612,7 +619,7 @@ void handle_rwlock_unlock(void *key, THREADID tid)
                 THREAD_INFO *awake = rw->locked;
                 rw->locked = rw->locked->next_lock;
                 insert_rwlock_users(rw, awake);
-                thread_unlock(awake, t);
+                thread_unlock(awake, t, key, CAUSE_RWLOCK);
                 rw->status = RW_WRITING;
             }
         }
@@ -634,19 +641,19 @@ void handle_rwlock_unlock(void *key, THREADID tid)
                 THREAD_INFO *awake = rw->locked;
                 rw->locked = rw->locked->next_lock;
                 insert_rwlock_users(rw, awake);
-                thread_unlock(awake, &all_threads[tid]);
+                thread_unlock(awake, &all_threads[tid], key, CAUSE_RWLOCK);
             } else {
                 // More complicated case, it's a reading request. Awake everyone.
                 for(THREAD_INFO *awake = rw->locked; awake != NULL; awake = awake->next_lock) {
                     if(awake->next_lock != NULL && ((RWLOCK_STATUS)((int64_t)awake->next_lock->holder) == RW_READING)) {
                         insert_rwlock_users(rw, awake);
-                        thread_unlock(awake->next_lock, t);
+                        thread_unlock(awake->next_lock, t, key, CAUSE_RWLOCK);
                         awake->next_lock = awake->next_lock->next_lock;
                     }
                 }
                 // Remove the first one.
                 insert_rwlock_users(rw, rw->locked);
-                thread_unlock(rw->locked, t);
+                thread_unlock(rw->locked, t, key, CAUSE_RWLOCK);
                 rw->locked = rw->locked->next_lock;
 
                 // Finally mark status
@@ -715,7 +722,7 @@ static void fail_on_no_cond(COND_ENTRY *s, void *key)
     }
 }
 
-static void cond_to_mutex(THREAD_INFO *t, THREADID tid)
+static void cond_to_mutex(THREAD_INFO *t, void *key, THREADID tid)
 {
     MUTEX_ENTRY *s = get_mutex_entry(t->holder);
     s = handle_no_mutex(s, t->holder);
@@ -723,7 +730,8 @@ static void cond_to_mutex(THREAD_INFO *t, THREADID tid)
     if(s->status == M_UNLOCKED) {
         // If unlocked, first to come, just lock.
         s->status = M_LOCKED;
-        thread_unlock(t, &all_threads[tid]);
+        thread_unlock(t, &all_threads[tid], key, CAUSE_COND);
+        s->acquired = t->ins_count;
         return;
     }
 
@@ -737,7 +745,7 @@ void handle_cond_broadcast(void *key, THREADID tid)
 
     // Unlock from condition variable but lock on the mutex.
     for(THREAD_INFO *t = c->locked; t != NULL; t = t->next_lock) {
-        cond_to_mutex(t, tid);
+        cond_to_mutex(t, key, tid);
     }
     c->locked = NULL;
 }
@@ -788,7 +796,7 @@ void handle_cond_signal(void *key, THREADID tid)
     if(c->locked != NULL) {
         THREAD_INFO *t = c->locked;
         c->locked = c->locked->next_lock;
-        cond_to_mutex(t, tid);
+        cond_to_mutex(t, key, tid);
     }
 }
 
@@ -923,7 +931,7 @@ void handle_reentrant_exit(REENTRANT_LOCK *rl, THREADID tid)
         return;
     }
 
-    thread_unlock(rl->locked, &all_threads[tid]);
+    thread_unlock(rl->locked, &all_threads[tid], rl, rl->cause);
 
     rl->locked = rl->locked->next_lock;
     return;
@@ -31,7 +31,7 @@ void handle_lock_init(void *key);
 void handle_lock(void *key, THREADID tid);
 
 // Returns 0 if lock was successfull, 1 otherwise. Will fail if doesn't exist.
-int handle_try_lock(void *key);
+int handle_try_lock(void *key, THREADID tid);
 
 // Oposite of handle_lock, could awake someone or mark the mutex as unlocked.
 void handle_unlock(void *key, THREADID tid);
@@ -121,6 +121,7 @@ typedef struct _REENTRANT_LOCK REENTRANT_LOCK;
 struct _REENTRANT_LOCK {
     int busy;
     THREAD_INFO *locked;            // Threads locked
+    WAKE_CAUSE cause;               // Reported when it releases someone
 };
 
 // handle_reentrant_start should be called at the start of a exclusive function.
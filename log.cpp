@@ -8,11 +8,22 @@
 
 #include "log.h"
 
-static THREADID watcher_tid;
+#define MAX_INTERNAL 4              // Tool internal threads, watcher included
+
+static THREADID internal_tids[MAX_INTERNAL];
+static int total_internal;
 
 void log_init(THREADID watcher)
 {
-    watcher_tid = watcher;
+    internal_tids[0] = watcher;
+    total_internal = 1;
+}
+
+void log_add_internal(THREADID tid)
+{
+    if(total_internal < MAX_INTERNAL) {
+        internal_tids[total_internal++] = tid;
+    }
 }
 
 void fail()
@@ -22,8 +33,11 @@ void fail()
 
 THREADID print_id(THREADID tid)
 {
-    if(tid > watcher_tid) {
-        return tid - 1;
+    THREADID id = tid;
+    for(int i = 0; i < total_internal; i++) {
+        if(tid > internal_tids[i]) {
+            id--;
+        }
     }
-    return tid;
+    return id;
 }
@@ -22,6 +22,9 @@
 
 void log_init(THREADID watcher);
 
+// Register another tool internal thread, besides the watcher.
+void log_add_internal(THREADID tid);
+
 // Due to watcher, exposed thread id should be different
 // than internal. Provide a converter.
 THREADID print_id(THREADID tid);
@@ -0,0 +1,278 @@
+/* numa.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "numa.h"
+#include "trace_bank.h"
+#include "top.h"
+#include "thread.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define STRIPES 64                  // Page table stripes, power of two
+#define HOT_PAGES 10                // Pages reported
+#define MAX_NODES 64
+
+typedef struct _PAGE_ENTRY PAGE_ENTRY;
+struct _PAGE_ENTRY {
+    UINT64 page;
+
+    UT_hash_handle hh;
+
+    int node;                       // Where it was placed
+    THREADID first_touch;
+
+    // Updated without the stripe lock, as entries never move.
+    UINT64 local;
+    UINT64 remote;
+};
+
+typedef struct {
+    PIN_MUTEX lock;
+    PAGE_ENTRY *pages;
+} STRIPE;
+
+typedef struct {
+    int node;
+    UINT64 local;
+    UINT64 remote;
+    UINT64 penalty;
+
+    PAGE_ENTRY *last;               // Last page touched
+} THREAD_NUMA;
+
+static int enabled;
+static int nodes;
+static UINT32 page_bits;
+static UINT32 remote_cost;
+
+static STRIPE stripes[STRIPES];
+static THREAD_NUMA threads[MAX_THREADS];
+static UINT64 node_pages[MAX_NODES];
+
+static TOP hot;
+
+int numa_init()
+{
+    enabled = knob_numa.Value() > 0 ? 1 : 0;
+    memset(threads, 0, sizeof(threads));
+    memset(node_pages, 0, sizeof(node_pages));
+    top_init(&hot, HOT_PAGES);
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    nodes = knob_numa.Value();
+    if(nodes > MAX_NODES) {
+        cerr << "[PINocchio] Error: Too many NUMA nodes, max is " << MAX_NODES << std::endl;
+        return -1;
+    }
+
+    UINT32 page_size = knob_numa_page.Value();
+    if(page_size == 0 || (page_size & (page_size - 1)) != 0) {
+        cerr << "[PINocchio] Error: NUMA page size should be a power of two: " << page_size << std::endl;
+        return -1;
+    }
+    for(page_bits = 0; (1U << page_bits) < page_size; page_bits++);
+
+    if(knob_numa_remote.Value() < 0) {
+        cerr << "[PINocchio] Error: NUMA remote cost should not be negative: " << knob_numa_remote.Value() << std::endl;
+        return -1;
+    }
+    remote_cost = knob_numa_remote.Value();
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        threads[i].node = i % nodes;
+    }
+    for(int i = 0; i < STRIPES; i++) {
+        PIN_MutexInit(&stripes[i].lock);
+        stripes[i].pages = NULL;
+    }
+
+    trace_bank_add_section("numa", numa_dump);
+    return 0;
+}
+
+int numa_enabled()
+{
+    return enabled;
+}
+
+// Find a page, placing it on the node of tid if first touched.
+static PAGE_ENTRY *get_page(UINT64 page, THREADID tid)
+{
+    STRIPE *s = &stripes[page & (STRIPES - 1)];
+    PAGE_ENTRY *e;
+
+    PIN_MutexLock(&s->lock);
+    HASH_FIND(hh, s->pages, &page, sizeof(UINT64), e);
+    if(e == NULL) {
+        e = (PAGE_ENTRY *) calloc(1, sizeof(PAGE_ENTRY));
+        if(e == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on NUMA page table." << std::endl;
+            fail();
+        }
+        e->page = page;
+        e->node = threads[tid].node;
+        e->first_touch = tid;
+        HASH_ADD(hh, s->pages, page, sizeof(UINT64), e);
+        __sync_fetch_and_add(&node_pages[e->node], 1);
+    }
+    PIN_MutexUnlock(&s->lock);
+
+    return e;
+}
+
+UINT32 numa_access(THREADID tid, ADDRINT addr)
+{
+    UINT64 page = (UINT64) addr >> page_bits;
+    THREAD_NUMA *t = &threads[tid];
+
+    PAGE_ENTRY *e = t->last;
+    if(e == NULL || e->page != page) {
+        e = get_page(page, tid);
+        t->last = e;
+    }
+
+    if(e->node == t->node) {
+        t->local++;
+        __sync_fetch_and_add(&e->local, 1);
+        return 0;
+    }
+
+    t->remote++;
+    t->penalty += remote_cost;
+    __sync_fetch_and_add(&e->remote, 1);
+    return remote_cost;
+}
+
+static void find_hot_pages()
+{
+    top_init(&hot, HOT_PAGES);
+
+    for(int i = 0; i < STRIPES; i++) {
+        for(PAGE_ENTRY *e = stripes[i].pages; e != NULL; e = (PAGE_ENTRY *) e->hh.next) {
+            if(e->remote > 0) {
+                top_offer(&hot, e, e->remote);
+            }
+        }
+    }
+}
+
+static double remote_ratio(UINT64 local, UINT64 remote)
+{
+    return local + remote > 0 ? (double) remote / (local + remote) : 0;
+}
+
+void numa_report()
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_NUMA *t = &threads[i];
+        if(t->local + t->remote == 0) {
+            continue;
+        }
+        cerr << "[PINocchio] NUMA thread " << print_id(i) << " (node " << t->node << "): "
+             << 100 * remote_ratio(t->local, t->remote) << "% remote" << std::endl;
+    }
+
+    find_hot_pages();
+    for(int i = 0; i < hot.total; i++) {
+        PAGE_ENTRY *e = (PAGE_ENTRY *) hot.items[i];
+        cerr << "[PINocchio] Remote page 0x" << hex << (e->page << page_bits) << dec << " (node "
+             << e->node << "): " << e->remote << " remote, " << e->local << " local" << std::endl;
+    }
+}
+
+void numa_dump(OUT_BUFFER *b)
+{
+    char str[32];
+
+    find_hot_pages();
+
+    out_buffer_str(b, "{\n    \"nodes\":");
+    out_buffer_u64(b, nodes);
+    out_buffer_str(b, ", \"page-bytes\":");
+    out_buffer_u64(b, 1ULL << page_bits);
+    out_buffer_str(b, ", \"remote-cost\":");
+    out_buffer_u64(b, remote_cost);
+
+    out_buffer_str(b, ",\n    \"pages-per-node\": [");
+    for(int i = 0; i < nodes; i++) {
+        out_buffer_str(b, i > 0 ? ", " : "");
+        out_buffer_u64(b, node_pages[i]);
+    }
+
+    out_buffer_str(b, "],\n    \"per-thread\": [");
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_NUMA *t = &threads[i];
+        if(t->local + t->remote == 0) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "\n      {\"pin-tid\":" : ",\n      {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        out_buffer_str(b, ", \"node\":");
+        out_buffer_u64(b, t->node);
+        out_buffer_str(b, ", \"local\":");
+        out_buffer_u64(b, t->local);
+        out_buffer_str(b, ", \"remote\":");
+        out_buffer_u64(b, t->remote);
+        snprintf(str, sizeof(str), "%.6f", remote_ratio(t->local, t->remote));
+        out_buffer_str(b, ", \"remote-ratio\":");
+        out_buffer_str(b, str);
+        out_buffer_str(b, ", \"penalty\":");
+        out_buffer_u64(b, t->penalty);
+        out_buffer_char(b, '}');
+    }
+
+    out_buffer_str(b, "\n    ],\n    \"hot-pages\": [");
+    for(int i = 0; i < hot.total; i++) {
+        PAGE_ENTRY *e = (PAGE_ENTRY *) hot.items[i];
+
+        snprintf(str, sizeof(str), "\"0x%llx\"", (unsigned long long)(e->page << page_bits));
+        out_buffer_str(b, i > 0 ? ",\n      {\"page\":" : "\n      {\"page\":");
+        out_buffer_str(b, str);
+        out_buffer_str(b, ", \"node\":");
+        out_buffer_u64(b, e->node);
+        out_buffer_str(b, ", \"first-touch\":");
+        out_buffer_u64(b, print_id(e->first_touch));
+        out_buffer_str(b, ", \"local\":");
+        out_buffer_u64(b, e->local);
+        out_buffer_str(b, ", \"remote\":");
+        out_buffer_u64(b, e->remote);
+        out_buffer_char(b, '}');
+    }
+    out_buffer_str(b, "\n    ]\n  }");
+}
+
+void numa_free()
+{
+    PAGE_ENTRY *e, *tmp;
+
+    for(int i = 0; i < STRIPES; i++) {
+        HASH_ITER(hh, stripes[i].pages, e, tmp) {
+            HASH_DEL(stripes[i].pages, e);
+            free(e);
+        }
+    }
+    for(int i = 0; i < MAX_THREADS; i++) {
+        threads[i].last = NULL;
+    }
+    top_init(&hot, HOT_PAGES);
+}
@@ -0,0 +1,45 @@
+/* numa.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+/*
+NUMA model (-numa NODES). Threads are bound to nodes round robin by their
+pin tid, and pages of -numa-page bytes are placed on the node of the first
+thread touching them. Accesses to a page placed on another node are charged
+-numa-remote extra cycles.
+
+Pages never move once placed, so each thread caches the last page it
+touched and only goes to the shared page table, split in locked stripes,
+when it moves to another page. Per-thread local and remote counts and the
+pages with the most remote accesses are reported.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+// Parse NUMA knobs. Returns 0 on success, -1 if invalid.
+int numa_init();
+
+// Returns 1 if the NUMA model is enabled.
+int numa_enabled();
+
+// Access on addr by tid, returning the penalty in cycles.
+UINT32 numa_access(THREADID tid, ADDRINT addr);
+
+// Print remote ratios and the pages with most remote accesses on stderr.
+void numa_report();
+
+// Section writer of NUMA statistics, see trace_bank_add_section.
+void numa_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void numa_free();
+
+#endif // NUMA_H_
@@ -0,0 +1,214 @@
+/* offcpu.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "offcpu.h"
+#include "out_buffer.h"
+#include "trace_samples.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+typedef struct {
+    ADDRINT target;
+    ADDRINT sp;
+} FRAME;
+
+typedef struct {
+    FRAME frames[OFFCPU_MAX_DEPTH];
+    int depth;
+
+    // Saved when blocked, the last key entry is filled with the cause.
+    ADDRINT blocked[OFFCPU_MAX_DEPTH + 1];
+    int blocked_depth;
+    UINT64 blocked_time;
+    int is_blocked;
+} SHADOW_STACK;
+
+// Blocked time of a stack, keyed by its targets plus the wake cause.
+typedef struct _STACK_ENTRY STACK_ENTRY;
+struct _STACK_ENTRY {
+    ADDRINT *key;
+    int depth;                      // Frames on key, without the cause
+
+    UT_hash_handle hh;
+
+    UINT64 time;
+};
+
+static int enabled;
+static SHADOW_STACK *stacks;
+static STACK_ENTRY *entries;
+
+int offcpu_init(int pram)
+{
+    enabled = knob_offcpu.Value() != "" ? 1 : 0;
+    stacks = NULL;
+    entries = NULL;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    if(pram == 0) {
+        cerr << "[PINocchio] Warning: Off-CPU profile needs PRAM mode, ignoring it." << std::endl;
+        enabled = 0;
+        return 0;
+    }
+
+    stacks = (SHADOW_STACK *) calloc(MAX_THREADS, sizeof(SHADOW_STACK));
+    if(stacks == NULL) {
+        cerr << "[PINocchio] Error: Out of memory on shadow stacks." << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int offcpu_enabled()
+{
+    return enabled;
+}
+
+// Drop frames at or below sp, they already returned.
+static inline void unwind(SHADOW_STACK *s, ADDRINT sp)
+{
+    while(s->depth > 0 && s->frames[s->depth - 1].sp <= sp) {
+        s->depth--;
+    }
+}
+
+void offcpu_call(THREADID tid, ADDRINT target, ADDRINT sp)
+{
+    SHADOW_STACK *s = &stacks[tid];
+
+    unwind(s, sp);
+    if(s->depth < OFFCPU_MAX_DEPTH) {
+        s->frames[s->depth].target = target;
+        s->frames[s->depth].sp = sp;
+        s->depth++;
+    }
+}
+
+void offcpu_ret(THREADID tid, ADDRINT sp)
+{
+    // The return address is on top, the call happened one word above.
+    unwind(&stacks[tid], sp + sizeof(ADDRINT));
+}
+
+void offcpu_block(THREADID tid, UINT64 time)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    SHADOW_STACK *s = &stacks[tid];
+    for(int i = 0; i < s->depth; i++) {
+        s->blocked[i] = s->frames[i].target;
+    }
+    s->blocked_depth = s->depth;
+    s->blocked_time = time;
+    s->is_blocked = 1;
+}
+
+void offcpu_wake(THREADID tid, UINT64 time, WAKE_CAUSE cause)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    SHADOW_STACK *s = &stacks[tid];
+    if(s->is_blocked == 0) {
+        return;
+    }
+    s->is_blocked = 0;
+
+    if(time <= s->blocked_time) {
+        return;
+    }
+
+    // Always called from sync, so entries are never updated concurrently.
+    s->blocked[s->blocked_depth] = (ADDRINT) cause;
+    size_t length = (s->blocked_depth + 1) * sizeof(ADDRINT);
+
+    STACK_ENTRY *e;
+    HASH_FIND(hh, entries, s->blocked, length, e);
+    if(e == NULL) {
+        e = (STACK_ENTRY *) malloc(sizeof(STACK_ENTRY));
+        if(e == NULL || (e->key = (ADDRINT *) malloc(length)) == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on off-CPU stacks." << std::endl;
+            fail();
+        }
+        memcpy(e->key, s->blocked, length);
+        e->depth = s->blocked_depth;
+        e->time = 0;
+        HASH_ADD_KEYPTR(hh, entries, e->key, length, e);
+    }
+    e->time += time - s->blocked_time;
+}
+
+static void dump_frame(OUT_BUFFER *b, ADDRINT target)
+{
+    char str[32];
+
+    string name = RTN_FindNameByAddress(target);
+    if(name == "") {
+        snprintf(str, sizeof(str), "0x%llx", (unsigned long long) target);
+        out_buffer_str(b, str);
+        return;
+    }
+    out_buffer_str(b, name.c_str());
+}
+
+void offcpu_dump()
+{
+    static OUT_BUFFER b;
+
+    if(enabled == 0) {
+        return;
+    }
+
+    if(out_buffer_open(&b, knob_offcpu.Value().c_str()) < 0) {
+        cerr << "[PINocchio] Error: Can't open off-CPU output: " << knob_offcpu.Value() << std::endl;
+        return;
+    }
+
+    // Symbols are only resolved here, once per frame written.
+    PIN_LockClient();
+    for(STACK_ENTRY *e = entries; e != NULL; e = (STACK_ENTRY *) e->hh.next) {
+        for(int i = 0; i < e->depth; i++) {
+            dump_frame(&b, e->key[i]);
+            out_buffer_char(&b, ';');
+        }
+        out_buffer_char(&b, '[');
+        out_buffer_str(&b, wake_cause_name((WAKE_CAUSE) e->key[e->depth]));
+        out_buffer_str(&b, "] ");
+        out_buffer_u64(&b, e->time);
+        out_buffer_char(&b, '\n');
+    }
+    PIN_UnlockClient();
+
+    out_buffer_close(&b);
+    cerr << "[PINocchio] Off-CPU stacks written to " << knob_offcpu.Value() << std::endl;
+}
+
+void offcpu_free()
+{
+    STACK_ENTRY *e, *tmp;
+    HASH_ITER(hh, entries, e, tmp) {
+        HASH_DEL(entries, e);
+        free(e->key);
+        free(e);
+    }
+
+    free(stacks);
+    stacks = NULL;
+    enabled = 0;
+}
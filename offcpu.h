@@ -0,0 +1,54 @@
+/* offcpu.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef OFFCPU_H_
+#define OFFCPU_H_
+
+/*
+Off-CPU profile (-offcpu FILE): simulated time spent LOCKED, summed per call
+stack and written in folded format (one "frame;frame;...;leaf time" line
+per stack), ready for flamegraph.pl.
+
+Each thread keeps a shadow stack of call targets, tagged with the stack
+pointer at the call. Hooked pthread functions are replaced and never
+execute their ret, so frames are not only popped on ret but also whenever
+a call or ret shows they are below the current stack pointer. When a
+thread blocks its stack is saved, and on wake up the blocked time is added
+to that stack, with the wake cause as leaf frame.
+*/
+
+#include "thread.h"
+#include "pin.H"
+
+#define OFFCPU_MAX_DEPTH 128        // Deeper frames are not kept
+
+// Parse off-CPU knobs. Returns 0 on success, -1 if invalid.
+int offcpu_init(int pram);
+
+// Returns 1 if the off-CPU profile is enabled.
+int offcpu_enabled();
+
+// Thread tid calling target, with the stack pointer before the call.
+void offcpu_call(THREADID tid, ADDRINT target, ADDRINT sp);
+
+// Thread tid returning, with the stack pointer at the ret.
+void offcpu_ret(THREADID tid, ADDRINT sp);
+
+// Thread tid got LOCKED at time.
+void offcpu_block(THREADID tid, UINT64 time);
+
+// Thread tid resumed at time, released with cause.
+void offcpu_wake(THREADID tid, UINT64 time, WAKE_CAUSE cause);
+
+// Write the folded stacks.
+void offcpu_dump();
+
+// Free allocated memory.
+void offcpu_free();
+
+#endif // OFFCPU_H_
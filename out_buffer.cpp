@@ -0,0 +1,119 @@
+/* out_buffer.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "out_buffer.h"
+#include <string.h>
+
+// Digits of the largest uint64_t.
+#define MAX_U64_DIGITS 20
+
+static const char digit_pairs[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+int out_buffer_open(OUT_BUFFER *b, const char *filename)
+{
+    b->used = 0;
+    b->f = fopen(filename, "w");
+    return b->f != NULL ? 0 : -1;
+}
+
+void out_buffer_flush(OUT_BUFFER *b)
+{
+    if(b->used > 0) {
+        fwrite(b->data, 1, b->used, b->f);
+        b->used = 0;
+    }
+}
+
+void out_buffer_close(OUT_BUFFER *b)
+{
+    out_buffer_flush(b);
+    fclose(b->f);
+    b->f = NULL;
+}
+
+void out_buffer_str(OUT_BUFFER *b, const char *s)
+{
+    size_t n = strlen(s);
+
+    // Too big to ever fit, write it straight away.
+    if(n > OUT_BUFFER_SIZE) {
+        out_buffer_flush(b);
+        fwrite(s, 1, n, b->f);
+        return;
+    }
+
+    if(b->used + n > OUT_BUFFER_SIZE) {
+        out_buffer_flush(b);
+    }
+    memcpy(&b->data[b->used], s, n);
+    b->used += n;
+}
+
+void out_buffer_char(OUT_BUFFER *b, char c)
+{
+    if(b->used >= OUT_BUFFER_SIZE) {
+        out_buffer_flush(b);
+    }
+    b->data[b->used++] = c;
+}
+
+void out_buffer_escaped(OUT_BUFFER *b, const char *s)
+{
+    char str[8];
+
+    for(; *s != '\0'; s++) {
+        unsigned char c = (unsigned char) *s;
+        if(c == '"' || c == '\\') {
+            out_buffer_char(b, '\\');
+            out_buffer_char(b, (char) c);
+        } else if(c < 0x20) {
+            snprintf(str, sizeof(str), "\\u%04x", c);
+            out_buffer_str(b, str);
+        } else {
+            out_buffer_char(b, (char) c);
+        }
+    }
+}
+
+void out_buffer_u64(OUT_BUFFER *b, uint64_t v)
+{
+    char tmp[MAX_U64_DIGITS];
+    int pos = MAX_U64_DIGITS;
+
+    // Fill from the end, two digits per division.
+    while(v >= 100) {
+        int pair = (int)(v % 100) * 2;
+        v /= 100;
+        tmp[--pos] = digit_pairs[pair + 1];
+        tmp[--pos] = digit_pairs[pair];
+    }
+    if(v >= 10) {
+        int pair = (int) v * 2;
+        tmp[--pos] = digit_pairs[pair + 1];
+        tmp[--pos] = digit_pairs[pair];
+    } else {
+        tmp[--pos] = (char)('0' + v);
+    }
+
+    int n = MAX_U64_DIGITS - pos;
+    if(b->used + n > OUT_BUFFER_SIZE) {
+        out_buffer_flush(b);
+    }
+    memcpy(&b->data[b->used], &tmp[pos], n);
+    b->used += n;
+}
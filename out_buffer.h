@@ -0,0 +1,52 @@
+/* out_buffer.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef OUT_BUFFER_H_
+#define OUT_BUFFER_H_
+
+/*
+out_buffer is a small buffered writer used by the exporters. Text is appended
+to a fixed buffer and only handed to stdio when it fills, and integers are
+converted in place, two digits at a time, without going through printf.
+It doesn't depend on Pin, so it can be used by standalone tools as well.
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define OUT_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+    FILE *f;
+    size_t used;
+    char data[OUT_BUFFER_SIZE];
+} OUT_BUFFER;
+
+// Open filename for writing. Returns 0 on success, -1 otherwise.
+int out_buffer_open(OUT_BUFFER *b, const char *filename);
+
+// Flush and close the file.
+void out_buffer_close(OUT_BUFFER *b);
+
+// Hand everything buffered so far to the file.
+void out_buffer_flush(OUT_BUFFER *b);
+
+// Append a null terminated string.
+void out_buffer_str(OUT_BUFFER *b, const char *s);
+
+// Append a single character.
+void out_buffer_char(OUT_BUFFER *b, char c);
+
+// Append a null terminated string escaped to go inside a JSON string, for
+// names coming from the application or the command line.
+void out_buffer_escaped(OUT_BUFFER *b, const char *s);
+
+// Append an unsigned integer in decimal.
+void out_buffer_u64(OUT_BUFFER *b, uint64_t v);
+
+#endif // OUT_BUFFER_H_
@@ -0,0 +1,143 @@
+/* record.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "record.h"
+#include "sync_cost.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+#define RECORD_VERSION 1
+#define RECORD_BUFFER (1 << 20)
+
+static int enabled;
+static FILE *file;
+static UINT64 events;
+
+static UINT64 last[MAX_THREADS];    // ins_count when the previous sync returned
+static UINT64 pending[MAX_THREADS]; // Executed before the current sync
+
+int record_init(int pram)
+{
+    enabled = knob_record.Value() != "" ? 1 : 0;
+    file = NULL;
+    events = 0;
+    memset(last, 0, sizeof(last));
+    memset(pending, 0, sizeof(pending));
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    if(pram == 0) {
+        cerr << "[PINocchio] Warning: Recording needs PRAM mode, ignoring it." << std::endl;
+        enabled = 0;
+        return 0;
+    }
+
+    file = fopen(knob_record.Value().c_str(), "w");
+    if(file == NULL) {
+        cerr << "[PINocchio] Error: Can't open record file: " << knob_record.Value() << std::endl;
+        return -1;
+    }
+    setvbuf(file, NULL, _IOFBF, RECORD_BUFFER);
+
+    fprintf(file, "# pinocchio-record %d\n", RECORD_VERSION);
+    fprintf(file, "# TID ACTION INSTRUCTIONS OBJECT OBJECT2 VALUE\n");
+    return 0;
+}
+
+int record_enabled()
+{
+    return enabled;
+}
+
+void record_enter(ACTION *action)
+{
+    if(enabled == 0 || action->action_type == ACTION_DONE) {
+        return;
+    }
+
+    THREADID tid = action->tid;
+    pending[tid] = all_threads[tid].ins_count - last[tid];
+}
+
+// Pin tid of a pthread_t, MAX_THREADS if unknown.
+static THREADID find_thread(pthread_t value)
+{
+    for(THREADID i = 1; i <= max_tid; i++) {
+        if(all_threads[i].create_value == value) {
+            return i;
+        }
+    }
+    return MAX_THREADS;
+}
+
+void record_sync(ACTION *action, THREADID creator)
+{
+    if(enabled == 0 || action->action_type == ACTION_DONE) {
+        return;
+    }
+
+    UINT64 object = (UINT64) action->arg.p_1;
+    UINT64 object2 = 0;
+    int value = 0;
+
+    switch(action->action_type) {
+    case ACTION_REGISTER:
+        object = action->tid > 0 ? creator : 0;
+        break;
+    case ACTION_AFTER_CREATE:
+        object = 0;
+        break;
+    case ACTION_BEFORE_JOIN:
+        object = find_thread((pthread_t) action->arg.p_1);
+        break;
+    case ACTION_COND_WAIT:
+        object2 = (UINT64) action->arg.p_2;
+        break;
+    case ACTION_SEM_INIT:
+    case ACTION_TRY_LOCK:
+    case ACTION_SEM_GETVALUE:
+    case ACTION_SEM_TRYWAIT:
+    case ACTION_RWLOCK_TRYRDLOCK:
+    case ACTION_RWLOCK_TRYWRLOCK:
+        value = action->arg.i;
+        break;
+    default:
+        break;
+    }
+
+    fprintf(file, "%u %s %llu %#llx %#llx %d\n", action->tid, sync_cost_name(action->action_type),
+            (unsigned long long) pending[action->tid], (unsigned long long) object,
+            (unsigned long long) object2, value);
+    events++;
+}
+
+void record_exit(ACTION *action)
+{
+    if(enabled == 0 || action->action_type == ACTION_DONE) {
+        return;
+    }
+
+    last[action->tid] = all_threads[action->tid].ins_count;
+}
+
+void record_free()
+{
+    if(file == NULL) {
+        return;
+    }
+
+    fclose(file);
+    file = NULL;
+    cerr << "[PINocchio] Recorded " << events << " sync events to " << knob_record.Value() << std::endl;
+}
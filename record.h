@@ -0,0 +1,52 @@
+/* record.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef RECORD_H_
+#define RECORD_H_
+
+/*
+Recording of sync events (-record FILE), to be simulated again offline by
+pinocchio-replay (replay/replay.cpp) without running the application. Each
+hooked call is one line, in the order they were handled under sync_mutex:
+
+  TID ACTION INSTRUCTIONS OBJECT OBJECT2 VALUE
+
+ACTION is the name used by sync_cost_name. INSTRUCTIONS is what the thread
+executed since its previous sync call returned, as charged by the cost
+model, cache, coherence and the other models, but without sync costs and
+wake ups, which replay charges itself. OBJECT is the address of the sync
+primitive, except on register (the creator pin tid) and join (the joined pin
+tid); OBJECT2 is the mutex of a cond-wait. VALUE is the sem-init value or the
+result of the try and getvalue calls. Lines starting with '#' are comments.
+
+Plain steps (ACTION_DONE) are not recorded, so the log doesn't depend on -p.
+PRAM mode only.
+*/
+
+#include "sync.h"
+#include "pin.H"
+
+// Parse record knobs and open its file. Returns 0 on success, -1 if invalid.
+int record_init(int pram);
+
+// Returns 1 if sync events are being recorded.
+int record_enabled();
+
+// Thread entering sync, takes the instructions executed since the last one.
+void record_enter(ACTION *action);
+
+// Write a handled action, creator is the one of a register. Called under sync_mutex.
+void record_sync(ACTION *action, THREADID creator);
+
+// Thread leaving sync, its next instructions start counting from here.
+void record_exit(ACTION *action);
+
+// Close the file.
+void record_free();
+
+#endif // RECORD_H_
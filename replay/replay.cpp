@@ -0,0 +1,993 @@
+/* replay.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+/*
+Offline replay of a -record log: simulates the execution again from the
+instructions each thread ran between sync calls, without Pin or the
+application, so the sync period, cost table and number of processors can be
+changed in seconds. Usage:
+
+    pinocchio-replay [-p PERIOD] [-c CORES] [-s SYNC_COST] [-x POLICY] [-o OUTPUT] RECORD
+
+POLICY picks the next thread to run its sync call, as exec_tracker does:
+
+- min (default): the one with the lowest time, as in PRAM mode. With a
+  PERIOD, threads within the same PERIOD window are taken in the order they
+  got there, like -p lets threads run ahead up to it.
+- fifo: the order threads got ready, regardless of time.
+- recorded: the order of the recorded run.
+
+Mutexes, semaphores and rwlocks are simulated again with the same rules as
+lock_hash, so contention follows the new timing. Try calls keep their
+recorded result (a successful one waits if the replay has it taken), joins
+wait for the joined thread and a cond-wait waits for the signal or broadcast
+that released it on the recording. Threads still waiting when thread 0
+finishes end with it. As calls can run out of time order with a PERIOD or
+another policy, taking something free or joining a finished thread still
+waits for its last release or end. A thread creation that waited on
+create_lock for the previous ones to end does so again. With CORES, every run
+between two sync calls takes a processor, in the first gap it fits from the
+time it got ready, as runs aren't booked in time order; time spent waiting
+for one is reported as queued. SYNC_COST is a table as in -sync-cost.
+
+The summary is printed like the tool does, and OUTPUT gets the -stats-only
+layout.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <iostream>
+#include "../sync_types.h"
+#include "../sync_cost.h"
+#include "../uthash.h"
+
+#define NONE (-1)
+
+typedef enum {
+    POLICY_MIN = 0,
+    POLICY_FIFO = 1,
+    POLICY_RECORDED = 2,
+} POLICY;
+
+typedef struct {
+    int action;
+    uint64_t ins;                   // Executed before the call
+    uint64_t object;
+    uint64_t object2;
+    int value;
+    uint64_t time;                  // When it ran on this replay
+    int signal;                     // cond-wait: event that released it, NONE if never
+    int next;                       // Next waiter on the same cond, while loading
+    int done;
+} EVENT;
+
+typedef struct _THREAD THREAD;
+struct _THREAD {
+    int *events;                    // Indexes on events, in order
+    int total;
+    int size;
+    int next;
+
+    int *children;                  // Threads created, in order
+    int total_children;
+    int size_children;
+    int next_child;
+    int after_creates;              // Seen while loading
+    int early;                      // Registered before its creator's after-create
+
+    THREAD_STATUS status;
+    uint64_t time;                  // Of the next sync call, or when it blocked or ended
+    uint64_t ticket;                // Order it got ready
+    uint64_t sync_cost;             // Cost of a sync call that blocked, charged on wake up
+    int reading;                    // Mode waited for on a rwlock
+    uint64_t cond_mutex;
+
+    int registered;
+    uint64_t start;
+    uint64_t end;
+    uint64_t locked;
+    uint64_t queued;
+    uint64_t blocks;
+
+    THREAD *next_lock;              // Queue on an object
+    THREAD *joiners;
+};
+
+// Time a processor is taken by a run.
+typedef struct {
+    uint64_t begin;
+    uint64_t end;
+} BUSY;
+
+typedef struct {
+    BUSY *busy;                     // In time order, not overlapping
+    int total;
+    int size;
+} CORE;
+
+// Any sync primitive, by address.
+typedef struct {
+    uint64_t key;
+    int held;                       // Mutex locked, rwlock readers or -1 if writing
+    int value;                      // Semaphore
+    uint64_t released;              // Last unlock or post
+    THREAD *locked;
+    int head;                       // cond-waits not released yet, while loading
+    int tail;
+
+    UT_hash_handle hh;
+} OBJECT;
+
+static EVENT *events;
+static int total_events;
+static int size_events;
+
+static THREAD threads[MAX_THREADS];
+static OBJECT *objects;
+
+// create_lock as handled on the recording, while loading.
+static int creates;
+static int create_busy;
+static int create_waiting;
+static int create_parts;
+
+static int created;                 // Creations finished on the replay
+static uint64_t created_time;       // When the last one did
+static THREAD *create_locked;       // Waiting for them
+
+static POLICY policy;
+static uint64_t period;
+static int total_cores;
+static CORE *cores;
+static uint64_t tickets;
+static uint64_t wakes;
+
+static const char *policy_names[] = {"min", "fifo", "recorded"};
+
+static void *grow(void *p, int *size, size_t entry)
+{
+    *size = *size > 0 ? *size * 2 : 64;
+    p = realloc(p, *size * entry);
+    if(p == NULL) {
+        std::cerr << "[PINocchio] Error: Out of memory on replay." << std::endl;
+        exit(1);
+    }
+    return p;
+}
+
+static OBJECT *get_object(uint64_t key)
+{
+    OBJECT *o;
+    HASH_FIND(hh, objects, &key, sizeof(uint64_t), o);
+    if(o != NULL) {
+        return o;
+    }
+
+    o = (OBJECT *) calloc(1, sizeof(OBJECT));
+    if(o == NULL) {
+        std::cerr << "[PINocchio] Error: Out of memory on replay." << std::endl;
+        exit(1);
+    }
+    o->key = key;
+    o->head = NONE;
+    o->tail = NONE;
+    HASH_ADD(hh, objects, key, sizeof(uint64_t), o);
+    return o;
+}
+
+static int find_action(const char *name)
+{
+    for(int i = 0; i < SYNC_COST_ACTIONS; i++) {
+        if(strcmp(sync_cost_name(i), name) == 0) {
+            return i;
+        }
+    }
+    return NONE;
+}
+
+// Match every cond-wait with the signal or broadcast that released it, the
+// recorded order being the one lock_hash handled them in.
+static void match_cond(int index)
+{
+    EVENT *e = &events[index];
+    OBJECT *c = get_object(e->object);
+
+    if(e->action == ACTION_COND_WAIT) {
+        if(c->tail != NONE) {
+            events[c->tail].next = index;
+        } else {
+            c->head = index;
+        }
+        c->tail = index;
+        return;
+    }
+
+    while(c->head != NONE) {
+        events[c->head].signal = index;
+        c->head = events[c->head].next;
+        if(e->action == ACTION_COND_SIGNAL) {
+            break;
+        }
+    }
+    if(c->head == NONE) {
+        c->tail = NONE;
+    }
+}
+
+// A creation ends once both its after-create and register are done.
+static void create_part()
+{
+    if(++create_parts < 2) {
+        return;
+    }
+    create_parts = 0;
+    if(create_waiting > 0) {
+        create_waiting--;
+    } else {
+        create_busy = 0;
+    }
+}
+
+static int load(const char *filename)
+{
+    char line[512];
+    char name[64];
+    unsigned tid;
+    unsigned long long ins, object, object2;
+    int value, number = 0;
+
+    FILE *f = fopen(filename, "r");
+    if(f == NULL) {
+        std::cerr << "[PINocchio] Error: Can't open record: " << filename << std::endl;
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        number++;
+        if(line[0] == '#') {
+            continue;
+        }
+        if(strchr(line, '\n') == NULL && feof(f)) {
+            // Last line cut, the run didn't exit cleanly.
+            break;
+        }
+
+        int action = NONE;
+        if(sscanf(line, "%u %63s %llu %lli %lli %d", &tid, name, &ins, (long long *) &object,
+                  (long long *) &object2, &value) == 6) {
+            action = find_action(name);
+        }
+        if(action == NONE || tid >= MAX_THREADS) {
+            std::cerr << "[PINocchio] Error: Invalid record entry on " << filename << ":" << number << std::endl;
+            fclose(f);
+            return -1;
+        }
+
+        if(total_events == size_events) {
+            events = (EVENT *) grow(events, &size_events, sizeof(EVENT));
+        }
+        int index = total_events++;
+        EVENT *e = &events[index];
+        e->action = action;
+        e->ins = ins;
+        e->object = object;
+        e->object2 = object2;
+        e->value = value;
+        e->signal = NONE;
+        e->next = NONE;
+        e->done = 0;
+
+        THREAD *t = &threads[tid];
+        if(t->total == t->size) {
+            t->events = (int *) grow(t->events, &t->size, sizeof(int));
+        }
+        t->events[t->total++] = index;
+
+        if(action == ACTION_REGISTER && tid > 0 && object < MAX_THREADS) {
+            THREAD *creator = &threads[object];
+            if(creator->total_children == creator->size_children) {
+                creator->children = (int *) grow(creator->children, &creator->size_children, sizeof(int));
+            }
+            t->early = creator->after_creates <= creator->total_children ? 1 : 0;
+            creator->children[creator->total_children++] = tid;
+            create_part();
+        } else if(action == ACTION_AFTER_CREATE) {
+            t->after_creates++;
+            create_part();
+        } else if(action == ACTION_BEFORE_CREATE) {
+            // It waited on create_lock, until all creations before it ended.
+            e->value = create_busy > 0 ? creates : 0;
+            create_waiting += create_busy;
+            create_busy = 1;
+            creates++;
+        } else if(action == ACTION_COND_WAIT || action == ACTION_COND_SIGNAL || action == ACTION_COND_BROADCAST) {
+            match_cond(index);
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+// Runs are booked as threads get ready, which is not time order with a PERIOD
+// or another policy, so a run fills the first gap long enough from its time.
+// Returns where it fits, and the busy interval it goes before on at.
+static uint64_t core_fit(CORE *c, uint64_t time, uint64_t length, int *at)
+{
+    int i;
+    for(i = 0; i < c->total; i++) {
+        BUSY *b = &c->busy[i];
+        if(b->end <= time) {
+            continue;
+        }
+        if(b->begin >= time + length) {
+            break;
+        }
+        time = b->end;
+    }
+    *at = i;
+    return time;
+}
+
+static void core_book(CORE *c, int at, uint64_t begin, uint64_t end)
+{
+    BUSY *prev = at > 0 ? &c->busy[at - 1] : NULL;
+    BUSY *next = at < c->total ? &c->busy[at] : NULL;
+
+    // Joined with its neighbours when they touch, to keep the list short.
+    if(prev != NULL && prev->end == begin) {
+        prev->end = end;
+        if(next != NULL && next->begin == end) {
+            prev->end = next->end;
+            memmove(next, next + 1, (c->total - at - 1) * sizeof(BUSY));
+            c->total--;
+        }
+        return;
+    }
+    if(next != NULL && next->begin == end) {
+        next->begin = begin;
+        return;
+    }
+
+    if(c->total == c->size) {
+        c->busy = (BUSY *) grow(c->busy, &c->size, sizeof(BUSY));
+    }
+    memmove(&c->busy[at + 1], &c->busy[at], (c->total - at) * sizeof(BUSY));
+    c->busy[at].begin = begin;
+    c->busy[at].end = end;
+    c->total++;
+}
+
+// No run starts before the earliest thread, drop what ended until then.
+static void core_prune()
+{
+    uint64_t first = UINT64_MAX;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD *t = &threads[i];
+        if(t->registered > 0 && t->status != FINISHED && t->time < first) {
+            first = t->time;
+        }
+    }
+
+    for(int i = 0; i < total_cores; i++) {
+        CORE *c = &cores[i];
+        int n = 0;
+        while(n < c->total && c->busy[n].end <= first) {
+            n++;
+        }
+        memmove(c->busy, &c->busy[n], (c->total - n) * sizeof(BUSY));
+        c->total -= n;
+    }
+}
+
+static void finish(THREAD *t, uint64_t time);
+
+// Thread got ready at time, run until its next sync call.
+static void ready(THREAD *t, uint64_t time)
+{
+    if(t->next == t->total) {
+        // Record ended before this thread did.
+        finish(t, time);
+        return;
+    }
+
+    uint64_t begin = time;
+    uint64_t ins = events[t->events[t->next]].ins;
+    if(total_cores > 0 && ins > 0) {
+        int c = 0, at = 0;
+        core_prune();
+        begin = core_fit(&cores[0], time, ins, &at);
+        for(int i = 1; i < total_cores; i++) {
+            int i_at;
+            uint64_t i_begin = core_fit(&cores[i], time, ins, &i_at);
+            if(i_begin < begin) {
+                c = i;
+                at = i_at;
+                begin = i_begin;
+            }
+        }
+        t->queued += begin - time;
+        core_book(&cores[c], at, begin, begin + ins);
+    }
+
+    t->status = UNLOCKED;
+    t->time = begin + ins;
+    t->ticket = tickets++;
+}
+
+// Got what it waited for without blocking, but not before it was released,
+// as other threads may have run their calls ahead of it.
+static void acquire(THREAD *t, uint64_t released)
+{
+    if(released > t->time) {
+        t->locked += released - t->time;
+        t->time = released;
+    }
+}
+
+static void block(THREAD *t)
+{
+    t->status = LOCKED;
+    t->blocks++;
+}
+
+// Released by someone at time, as thread_unlock does.
+static void wake(THREAD *t, uint64_t time)
+{
+    uint64_t resume = time > t->time ? time : t->time;
+    resume += sync_cost_wake() + t->sync_cost;
+    t->locked += resume - t->time;
+    t->sync_cost = 0;
+    wakes++;
+    ready(t, resume);
+}
+
+static THREAD *insert(THREAD *list, THREAD *entry)
+{
+    entry->next_lock = NULL;
+    if(list == NULL) {
+        return entry;
+    }
+
+    THREAD *t;
+    for(t = list; t->next_lock != NULL; t = t->next_lock);
+    t->next_lock = entry;
+    return list;
+}
+
+static void lock_mutex(THREAD *t, OBJECT *o)
+{
+    if(o->held == 0) {
+        o->held = 1;
+        acquire(t, o->released);
+        return;
+    }
+    block(t);
+    o->locked = insert(o->locked, t);
+}
+
+static void unlock_mutex(OBJECT *o, uint64_t time)
+{
+    o->released = time;
+    if(o->locked == NULL) {
+        o->held = 0;
+        return;
+    }
+
+    THREAD *t = o->locked;
+    o->locked = t->next_lock;
+    wake(t, time);
+}
+
+static void sem_wait(THREAD *t, OBJECT *o)
+{
+    if(o->value > 0) {
+        o->value--;
+        acquire(t, o->released);
+        return;
+    }
+    block(t);
+    o->locked = insert(o->locked, t);
+}
+
+static void sem_post(OBJECT *o, uint64_t time)
+{
+    o->released = time;
+    if(o->locked == NULL) {
+        o->value++;
+        return;
+    }
+
+    THREAD *t = o->locked;
+    o->locked = t->next_lock;
+    wake(t, time);
+}
+
+static void rwlock_take(THREAD *t, OBJECT *o, int reading)
+{
+    // Readers get in while others read, even with writers waiting.
+    if(o->held == 0 || (reading > 0 && o->held > 0)) {
+        o->held = reading > 0 ? o->held + 1 : -1;
+        acquire(t, o->released);
+        return;
+    }
+    t->reading = reading;
+    block(t);
+    o->locked = insert(o->locked, t);
+}
+
+static void rwlock_unlock(OBJECT *o, uint64_t time)
+{
+    o->held = o->held > 0 ? o->held - 1 : 0;
+    o->released = time;
+    if(o->held > 0 || o->locked == NULL) {
+        return;
+    }
+
+    if(o->locked->reading == 0) {
+        THREAD *t = o->locked;
+        o->locked = t->next_lock;
+        o->held = -1;
+        wake(t, time);
+        return;
+    }
+
+    // A reader is first, all waiting readers get in.
+    THREAD *writers = NULL;
+    THREAD *t = o->locked;
+    while(t != NULL) {
+        THREAD *next = t->next_lock;
+        if(t->reading > 0) {
+            o->held++;
+            wake(t, time);
+        } else {
+            writers = insert(writers, t);
+        }
+        t = next;
+    }
+    o->locked = writers;
+}
+
+// Released from a cond, now it needs its mutex back.
+static void cond_to_mutex(THREAD *t, uint64_t time)
+{
+    OBJECT *m = get_object(t->cond_mutex);
+    if(m->held == 0) {
+        m->held = 1;
+        wake(t, time > m->released ? time : m->released);
+        return;
+    }
+    m->locked = insert(m->locked, t);
+}
+
+static void cond_release(OBJECT *c, int index, uint64_t time)
+{
+    THREAD *waiting = NULL;
+    THREAD *t = c->locked;
+    while(t != NULL) {
+        THREAD *next = t->next_lock;
+        EVENT *e = &events[t->events[t->next - 1]];
+        if(e->signal == index) {
+            cond_to_mutex(t, time);
+        } else {
+            waiting = insert(waiting, t);
+        }
+        t = next;
+    }
+    c->locked = waiting;
+}
+
+static void cond_wait(THREAD *t, EVENT *e, uint64_t time)
+{
+    unlock_mutex(get_object(e->object2), time);
+    t->cond_mutex = e->object2;
+
+    if(e->signal != NONE && events[e->signal].done > 0) {
+        // Released before it got here on this replay, only takes the mutex.
+        acquire(t, events[e->signal].time);
+        lock_mutex(t, get_object(e->object2));
+        return;
+    }
+
+    OBJECT *c = get_object(e->object);
+    block(t);
+    c->locked = insert(c->locked, t);
+}
+
+static void create_wait(THREAD *t, EVENT *e)
+{
+    if(e->value <= created) {
+        acquire(t, created_time);
+        return;
+    }
+    block(t);
+    create_locked = insert(create_locked, t);
+}
+
+static void create_end(uint64_t time)
+{
+    created++;
+    created_time = time;
+
+    THREAD *waiting = NULL;
+    THREAD *t = create_locked;
+    while(t != NULL) {
+        THREAD *next = t->next_lock;
+        if(events[t->events[t->next - 1]].value <= created) {
+            wake(t, time);
+        } else {
+            waiting = insert(waiting, t);
+        }
+        t = next;
+    }
+    create_locked = waiting;
+}
+
+// The creation ends here if the new thread registered before it did on the
+// recording, otherwise on its register.
+static void start_child(THREAD *t, uint64_t time)
+{
+    if(t->next_child == t->total_children) {
+        create_end(time);
+        return;
+    }
+
+    THREAD *child = &threads[t->children[t->next_child++]];
+    child->registered = 1;
+    child->start = time + sync_cost_create();
+    ready(child, child->start);
+    if(child->early > 0) {
+        create_end(time);
+    }
+}
+
+static void finish(THREAD *t, uint64_t time)
+{
+    t->status = FINISHED;
+    t->end = time;
+
+    for(THREAD *j = t->joiners; j != NULL;) {
+        THREAD *next = j->next_lock;
+        wake(j, time);
+        j = next;
+    }
+    t->joiners = NULL;
+}
+
+static void join(THREAD *t, uint64_t tid)
+{
+    if(tid >= MAX_THREADS || threads[tid].total == 0) {
+        return;
+    }
+    if(threads[tid].status == FINISHED) {
+        acquire(t, threads[tid].end);
+        return;
+    }
+    block(t);
+    threads[tid].joiners = insert(threads[tid].joiners, t);
+}
+
+// Run the next sync call of t, at its current time.
+static void run(THREAD *t)
+{
+    int index = t->events[t->next++];
+    EVENT *e = &events[index];
+    uint64_t now = t->time;
+    uint64_t wakes_before = wakes;
+
+    e->time = now;
+
+    switch(e->action) {
+    case ACTION_REGISTER:
+        if(t != &threads[0] && t->early == 0) {
+            create_end(now);
+        }
+        break;
+    case ACTION_FINI:
+        finish(t, now);
+        break;
+    case ACTION_BEFORE_CREATE:
+        create_wait(t, e);
+        break;
+    case ACTION_AFTER_CREATE:
+        start_child(t, now);
+        break;
+    case ACTION_BEFORE_JOIN:
+        join(t, e->object);
+        break;
+    case ACTION_LOCK_INIT:
+    case ACTION_LOCK_DESTROY:
+        get_object(e->object)->held = 0;
+        break;
+    case ACTION_TRY_LOCK:
+        if(e->value != 0) {
+            break;
+        }
+        // A successful try is a lock.
+        // fall through
+    case ACTION_LOCK:
+        lock_mutex(t, get_object(e->object));
+        break;
+    case ACTION_UNLOCK:
+        unlock_mutex(get_object(e->object), now);
+        break;
+    case ACTION_SEM_INIT:
+        get_object(e->object)->value = e->value;
+        break;
+    case ACTION_SEM_TRYWAIT:
+        if(e->value != 0) {
+            break;
+        }
+        // fall through
+    case ACTION_SEM_WAIT:
+        sem_wait(t, get_object(e->object));
+        break;
+    case ACTION_SEM_POST:
+        sem_post(get_object(e->object), now);
+        break;
+    case ACTION_RWLOCK_TRYRDLOCK:
+        if(e->value != 0) {
+            break;
+        }
+        // fall through
+    case ACTION_RWLOCK_RDLOCK:
+        rwlock_take(t, get_object(e->object), 1);
+        break;
+    case ACTION_RWLOCK_TRYWRLOCK:
+        if(e->value != 0) {
+            break;
+        }
+        // fall through
+    case ACTION_RWLOCK_WRLOCK:
+        rwlock_take(t, get_object(e->object), 0);
+        break;
+    case ACTION_RWLOCK_UNLOCK:
+        rwlock_unlock(get_object(e->object), now);
+        break;
+    case ACTION_COND_SIGNAL:
+    case ACTION_COND_BROADCAST:
+        cond_release(get_object(e->object), index, now);
+        break;
+    case ACTION_COND_WAIT:
+        cond_wait(t, e, now);
+        break;
+    default:
+        // Getvalue and the other inits and destroys.
+        break;
+    }
+    e->done = 1;
+
+    // Taking something already released may have waited for it.
+    if(t->status == UNLOCKED) {
+        now = t->time;
+    }
+
+    // As charge_sync_cost, contended if it blocked or woke someone.
+    if(sync_cost_enabled() > 0) {
+        uint32_t cost = sync_cost_action(e->action, t->status == LOCKED || wakes > wakes_before);
+        if(t->status == LOCKED) {
+            t->sync_cost += cost;
+        } else {
+            now += cost;
+        }
+    }
+
+    if(t->status == UNLOCKED) {
+        ready(t, now);
+    }
+}
+
+// Next thread to run a sync call, NULL if none can.
+static THREAD *pick()
+{
+    THREAD *best = NULL;
+    uint64_t best_key = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD *t = &threads[i];
+        if(t->status != UNLOCKED) {
+            continue;
+        }
+
+        uint64_t key;
+        if(policy == POLICY_RECORDED) {
+            key = t->events[t->next];
+        } else if(policy == POLICY_FIFO) {
+            key = t->ticket;
+        } else {
+            key = t->time / period;
+        }
+
+        if(best == NULL || key < best_key || (key == best_key && t->ticket < best->ticket)) {
+            best = t;
+            best_key = key;
+        }
+    }
+    return best;
+}
+
+static int simulate()
+{
+    for(int i = 0; i < MAX_THREADS; i++) {
+        threads[i].status = UNREGISTERED;
+    }
+    if(threads[0].total == 0) {
+        std::cerr << "[PINocchio] Error: Empty record." << std::endl;
+        return -1;
+    }
+
+    threads[0].registered = 1;
+    ready(&threads[0], 0);
+
+    for(int parked = 1; parked > 0;) {
+        for(THREAD *t = pick(); t != NULL; t = pick()) {
+            run(t);
+        }
+
+        if(threads[0].status != FINISHED) {
+            std::cerr << "[PINocchio] Error: Deadlock on replay, thread 0 never finished" << std::endl;
+            return -1;
+        }
+
+        // Still parked when the program ended, as detached or pool threads on
+        // a cond-wait never signaled: they end with thread 0. Their joiners,
+        // if any, run again.
+        parked = 0;
+        for(int i = 0; i < MAX_THREADS; i++) {
+            THREAD *t = &threads[i];
+            if(t->status == LOCKED) {
+                uint64_t end = threads[0].end > t->time ? threads[0].end : t->time;
+                t->locked += end - t->time;
+                finish(t, end);
+                parked = 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void report(const char *filename)
+{
+    uint64_t work = 0, queued = 0;
+    int registered = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD *t = &threads[i];
+        if(t->registered == 0) {
+            continue;
+        }
+        registered++;
+        work += t->end - t->start - t->locked - t->queued;
+        queued += t->queued;
+    }
+
+    uint64_t duration = threads[0].end;
+    double efficiency = duration > 0 ? (double) work / ((double) duration * registered) : 0;
+
+    std::cerr << "[PINocchio] Replayed " << total_events << " sync events, policy " << policy_names[policy]
+              << ", period " << period << ", " << total_cores << " cores" << std::endl;
+    std::cerr << "[PINocchio] Total Work:  " << work << " Cycles" << std::endl;
+    std::cerr << "[PINocchio] Duration:    " << duration << " Cycles" << std::endl;
+    std::cerr << "[PINocchio] Threads:     " << registered << std::endl;
+    std::cerr << "[PINocchio] Efficiency:  " << efficiency << std::endl;
+    if(total_cores > 0) {
+        std::cerr << "[PINocchio] Queued:      " << queued << " Cycles" << std::endl;
+    }
+    sync_cost_report();
+
+    if(filename == NULL) {
+        return;
+    }
+
+    FILE *f = fopen(filename, "w");
+    if(f == NULL) {
+        std::cerr << "[PINocchio] Error: Can't open replay output: " << filename << std::endl;
+        return;
+    }
+
+    fprintf(f, "{\n  \"unit\": \"Cycles\",\n  \"work\":%llu,\n  \"duration\":%llu,\n  \"span\":null,\n"
+            "  \"threads\":%d,\n  \"efficiency\":%.6f,\n  \"parallelism\":null,\n  \"profile\":null,\n"
+            "  \"policy\": \"%s\",\n  \"period\":%llu,\n  \"cores\":%d,\n  \"per-thread\": [",
+            (unsigned long long) work, (unsigned long long) duration, registered,
+            efficiency, policy_names[policy], (unsigned long long) period, total_cores);
+
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD *t = &threads[i];
+        if(t->registered == 0) {
+            continue;
+        }
+        fprintf(f, "%s{\"pin-tid\":%d, \"start\":%llu, \"end\":%llu, \"work\":%llu, \"locked\":%llu, "
+                "\"queued\":%llu, \"blocks\":%llu}", first > 0 ? "\n    " : ",\n    ", i,
+                (unsigned long long) t->start, (unsigned long long) t->end,
+                (unsigned long long)(t->end - t->start - t->locked - t->queued), (unsigned long long) t->locked,
+                (unsigned long long) t->queued, (unsigned long long) t->blocks);
+        first = 0;
+    }
+    fprintf(f, "\n  ]\n}\n");
+    fclose(f);
+}
+
+static void release()
+{
+    OBJECT *o, *tmp;
+    HASH_ITER(hh, objects, o, tmp) {
+        HASH_DEL(objects, o);
+        free(o);
+    }
+    for(int i = 0; i < MAX_THREADS; i++) {
+        free(threads[i].events);
+        free(threads[i].children);
+    }
+    free(events);
+    for(int i = 0; i < total_cores; i++) {
+        free(cores[i].busy);
+    }
+    free(cores);
+}
+
+static int usage(char *name)
+{
+    std::cerr << "Usage: " << name << " [-p PERIOD] [-c CORES] [-s SYNC_COST] [-x min|fifo|recorded]"
+              << " [-o OUTPUT] RECORD" << std::endl;
+    return 4;
+}
+
+int main(int argc, char **argv)
+{
+    const char *table = "";
+    const char *output = NULL;
+    int opt;
+
+    policy = POLICY_MIN;
+    period = 1;
+    total_cores = 0;
+
+    while((opt = getopt(argc, argv, "p:c:s:x:o:")) != -1) {
+        switch(opt) {
+        case 'p': period = strtoull(optarg, NULL, 10); break;
+        case 'c': total_cores = atoi(optarg); break;
+        case 's': table = optarg; break;
+        case 'o': output = optarg; break;
+        case 'x':
+            for(policy = POLICY_MIN; policy <= POLICY_RECORDED; policy = (POLICY)(policy + 1)) {
+                if(strcmp(optarg, policy_names[policy]) == 0) {
+                    break;
+                }
+            }
+            if(policy > POLICY_RECORDED) {
+                return usage(argv[0]);
+            }
+            break;
+        default:
+            return usage(argv[0]);
+        }
+    }
+
+    if(optind != argc - 1 || period == 0 || total_cores < 0) {
+        return usage(argv[0]);
+    }
+
+    if(sync_cost_init(table) < 0 || load(argv[optind]) < 0) {
+        return 1;
+    }
+
+    if(total_cores > 0) {
+        cores = (CORE *) calloc(total_cores, sizeof(CORE));
+    }
+
+    int result = simulate();
+    if(result == 0) {
+        report(output);
+    }
+    release();
+    return result < 0 ? 1 : 0;
+}
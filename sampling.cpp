@@ -0,0 +1,335 @@
+/* sampling.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "sampling.h"
+#include "trace_bank.h"
+#include "stats.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <iostream>
+
+typedef struct {
+    UINT64 length;                  // Detailed cycles covered by the run
+    UINT64 work;
+    double running;                 // work / length
+} SAMPLE;
+
+typedef struct {
+    int samples;
+    UINT64 work;                    // Counted in both phases, so exact
+    UINT64 duration;                // Stretched by the fast-forward
+    int threads;
+    UINT64 detailed_length;
+    UINT64 detailed_work;
+    UINT64 forward_work;
+    double running;                 // Ratio estimate over all samples
+    double running_ci;              // Half width of its interval
+} ESTIMATE;
+
+static int enabled;
+static UINT64 window;
+static UINT64 interval;
+static UINT64 period;               // window + interval
+
+// Locked time inside each sample, a sample covers 1 << scale periods.
+static UINT64 locked[SAMPLING_MAX_WINDOWS];
+static UINT64 alive[SAMPLING_MAX_WINDOWS];
+static SAMPLE samples[SAMPLING_MAX_WINDOWS];
+static UINT32 scale;
+static UINT64 forward_locked;
+
+static UINT64 block_time[MAX_THREADS];
+static UINT64 last_seen[MAX_THREADS];   // ins_count at the previous watcher check
+
+static ESTIMATE est;
+static int computed;
+
+// Detailed cycles in [0, time).
+static UINT64 detailed_before(UINT64 time)
+{
+    UINT64 rest = time % period;
+    return time / period * window + (rest < window ? rest : window);
+}
+
+static UINT64 sample_of(UINT64 time)
+{
+    return (time / period) >> scale;
+}
+
+// Merge neighbour samples until the one of time fits.
+static void make_room(UINT64 time)
+{
+    while(sample_of(time) >= SAMPLING_MAX_WINDOWS) {
+        for(UINT64 i = 0; i < SAMPLING_MAX_WINDOWS / 2; i++) {
+            locked[i] = locked[2 * i] + locked[2 * i + 1];
+        }
+        memset(&locked[SAMPLING_MAX_WINDOWS / 2], 0, sizeof(locked) / 2);
+        scale++;
+    }
+}
+
+// Add the detailed part of [start, end) to counters, one per sample.
+static void add_interval(UINT64 *counters, UINT64 start, UINT64 end)
+{
+    if(detailed_before(end) == detailed_before(start)) {
+        return;
+    }
+
+    for(UINT64 i = sample_of(start); i <= sample_of(end - 1); i++) {
+        UINT64 lo = (i << scale) * period;
+        UINT64 hi = lo + (period << scale);
+        counters[i] += detailed_before(end < hi ? end : hi) - detailed_before(start > lo ? start : lo);
+    }
+}
+
+int sampling_init(int pram)
+{
+    enabled = 0;
+    scale = 0;
+    forward_locked = 0;
+    computed = 0;
+    memset(locked, 0, sizeof(locked));
+    memset(block_time, 0, sizeof(block_time));
+    memset(last_seen, 0, sizeof(last_seen));
+
+    if(knob_sample_window.Value() == 0 && knob_sample_interval.Value() == 0) {
+        return 0;
+    }
+
+    if(knob_sample_window.Value() <= 0 || knob_sample_interval.Value() <= 0) {
+        cerr << "[PINocchio] Error: Sample window and interval should be both positive: "
+             << knob_sample_window.Value() << " " << knob_sample_interval.Value() << std::endl;
+        return -1;
+    }
+
+    if(pram == 0) {
+        cerr << "[PINocchio] Warning: Sampling needs PRAM mode, ignoring it." << std::endl;
+        return 0;
+    }
+
+    enabled = 1;
+    window = knob_sample_window.Value();
+    interval = knob_sample_interval.Value();
+    period = window + interval;
+
+    trace_bank_add_section("sampling", sampling_dump);
+    return 0;
+}
+
+int sampling_enabled()
+{
+    return enabled;
+}
+
+int sampling_detailed(UINT64 time)
+{
+    return time % period < window ? 1 : 0;
+}
+
+int sampling_has_advanced()
+{
+    int advanced = 0;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    // Read while the thread runs, only a change matters.
+    for(THREADID i = 0; i <= max_tid && i < MAX_THREADS; i++) {
+        UINT64 ins = all_threads[i].ins_count;
+        if(all_threads[i].status == UNLOCKED && sampling_detailed(ins) == 0 && ins != last_seen[i]) {
+            advanced = 1;
+        }
+        last_seen[i] = ins;
+    }
+    return advanced;
+}
+
+void sampling_block(THREADID tid, UINT64 time)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    block_time[tid] = time;
+}
+
+void sampling_wake(THREADID tid, UINT64 time)
+{
+    if(enabled == 0 || time <= block_time[tid]) {
+        return;
+    }
+
+    UINT64 start = block_time[tid];
+    forward_locked += (time - start) - (detailed_before(time) - detailed_before(start));
+
+    make_room(time - 1);
+    add_interval(locked, start, time);
+}
+
+// Split alive time the same way, then estimate from the samples.
+static void compute()
+{
+    STATS s;
+
+    if(computed > 0) {
+        return;
+    }
+    computed = 1;
+
+    stats_compute(&s);
+    memset(&est, 0, sizeof(est));
+    est.work = s.work;
+    est.duration = s.duration;
+    est.threads = s.threads;
+    if(s.duration == 0 || s.threads == 0) {
+        return;
+    }
+
+    make_room(s.duration - 1);
+    est.samples = sample_of(s.duration - 1) + 1;
+    memset(alive, 0, sizeof(alive));
+
+    UINT64 total_alive = 0;
+    for(THREADID i = 0; i <= max_tid && i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        UINT64 end = tr->end < s.duration ? tr->end : s.duration;
+        if(end > tr->start) {
+            add_interval(alive, tr->start, end);
+            total_alive += end - tr->start;
+        }
+    }
+
+    UINT64 detailed_alive = 0;
+    for(int i = 0; i < est.samples; i++) {
+        UINT64 lo = ((UINT64) i << scale) * period;
+        UINT64 hi = lo + (period << scale);
+        SAMPLE *sample = &samples[i];
+
+        sample->length = detailed_before(hi < s.duration ? hi : s.duration) - detailed_before(lo);
+        sample->work = alive[i] > locked[i] ? alive[i] - locked[i] : 0;
+        sample->running = sample->length > 0 ? (double) sample->work / sample->length : 0;
+
+        detailed_alive += alive[i];
+        est.detailed_length += sample->length;
+        est.detailed_work += sample->work;
+    }
+
+    UINT64 forward_alive = total_alive - detailed_alive;
+    est.forward_work = forward_alive > forward_locked ? forward_alive - forward_locked : 0;
+
+    // Ratio estimator, longer samples (the last one is clipped) weigh more.
+    est.running = (double) est.detailed_work / est.detailed_length;
+    if(est.samples < 2) {
+        return;
+    }
+
+    double mean_length = (double) est.detailed_length / est.samples;
+    double squares = 0;
+    for(int i = 0; i < est.samples; i++) {
+        double residual = samples[i].work - est.running * samples[i].length;
+        squares += residual * residual;
+    }
+    double deviation = sqrt(squares / (est.samples - 1)) / mean_length;
+    est.running_ci = SAMPLING_Z * deviation / sqrt((double) est.samples);
+}
+
+// Work done at the estimated running threads, with the relative error of it.
+static UINT64 estimated_duration()
+{
+    return est.running > 0 ? (UINT64)(est.work / est.running) : 0;
+}
+
+static UINT64 estimated_duration_ci()
+{
+    return est.running > 0 ? (UINT64)(est.work / est.running * (est.running_ci / est.running)) : 0;
+}
+
+void sampling_report()
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    compute();
+    if(est.detailed_length == 0) {
+        cerr << "[PINocchio] Sampling: no detailed window was reached" << std::endl;
+        return;
+    }
+
+    UINT64 forward_length = est.duration - est.detailed_length;
+    double detailed_efficiency = (double) est.detailed_work / ((double) est.detailed_length * est.threads);
+    double forward_efficiency = forward_length > 0 ?
+                                (double) est.forward_work / ((double) forward_length * est.threads) : 0;
+
+    cerr << "[PINocchio] Sampling: " << est.samples << " samples, " << est.detailed_length << " of "
+         << est.duration << " cycles detailed" << std::endl;
+    cerr << "[PINocchio]   estimated efficiency " << est.running / est.threads << " +- "
+         << est.running_ci / est.threads << ", duration " << estimated_duration() << " +- "
+         << estimated_duration_ci() << " (95%)" << std::endl;
+    cerr << "[PINocchio]   detailed work " << est.detailed_work << ", efficiency " << detailed_efficiency
+         << "; fast-forward work " << est.forward_work << ", efficiency " << forward_efficiency << std::endl;
+
+    if(est.samples < SAMPLING_MIN_WINDOWS) {
+        cerr << "[PINocchio] Warning: Only " << est.samples
+             << " samples, the interval is rough. Use a smaller window and interval." << std::endl;
+    }
+}
+
+void sampling_dump(OUT_BUFFER *b)
+{
+    char str[64];
+
+    compute();
+
+    out_buffer_str(b, "{\n    \"window\":");
+    out_buffer_u64(b, window);
+    out_buffer_str(b, ", \"interval\":");
+    out_buffer_u64(b, interval);
+    out_buffer_str(b, ", \"merged\":");
+    out_buffer_u64(b, 1ULL << scale);
+    out_buffer_str(b, ", \"detailed-length\":");
+    out_buffer_u64(b, est.detailed_length);
+    out_buffer_str(b, ", \"detailed-work\":");
+    out_buffer_u64(b, est.detailed_work);
+    out_buffer_str(b, ", \"fast-forward-work\":");
+    out_buffer_u64(b, est.forward_work);
+
+    snprintf(str, sizeof(str), ",\n    \"running\":%.4f, \"running-ci\":%.4f", est.running, est.running_ci);
+    out_buffer_str(b, str);
+    out_buffer_str(b, ", \"duration\":");
+    out_buffer_u64(b, estimated_duration());
+    out_buffer_str(b, ", \"duration-ci\":");
+    out_buffer_u64(b, estimated_duration_ci());
+    if(est.threads > 0) {
+        snprintf(str, sizeof(str), ", \"efficiency\":%.4f, \"efficiency-ci\":%.4f",
+                 est.running / est.threads, est.running_ci / est.threads);
+        out_buffer_str(b, str);
+    }
+
+    // Average running threads of each sample.
+    out_buffer_str(b, ",\n    \"samples\": [");
+    for(int i = 0; i < est.samples; i++) {
+        snprintf(str, sizeof(str), i > 0 ? ", %.3f" : "%.3f", samples[i].running);
+        out_buffer_str(b, str);
+    }
+    out_buffer_str(b, "]\n  }");
+}
+
+void sampling_free()
+{
+    enabled = 0;
+}
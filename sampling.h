@@ -0,0 +1,68 @@
+/* sampling.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef SAMPLING_H_
+#define SAMPLING_H_
+
+/*
+Sampled simulation (-sample-window W -sample-interval F). Simulated time is
+split in periods of W + F cycles: the first W are a detailed window, where
+threads step in lockstep as in exact PRAM mode (or every -p cycles), and the
+other F are fast-forwarded, where threads only count instructions and run
+free until a hooked call or the next window. Hooked calls are always handled,
+as the application depends on them, so blocking is still simulated during
+fast-forward, only without ordering threads by time.
+
+The time each thread spends LOCKED is split between the windows it falls on
+and the fast-forward, so the work done inside every window is known at exit.
+Each window gives a sample of the average running threads, and their mean
+estimates the efficiency of the whole run, with a 95% confidence interval
+from the spread between windows. Work is counted exactly in both phases,
+while duration is stretched by the fast-forward, so it's estimated as well,
+as the time the work takes at the estimated running threads. Windows are
+merged in pairs once there are too many, which keeps the mean and widens
+the interval a bit.
+PRAM mode only.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+#define SAMPLING_MAX_WINDOWS 65536      // Samples kept before merging neighbours
+#define SAMPLING_MIN_WINDOWS 30         // Below it the interval is rough
+#define SAMPLING_Z 1.96                 // 95% confidence
+
+// Parse sampling knobs. Returns 0 on success, -1 if invalid.
+int sampling_init(int pram);
+
+// Returns 1 if sampled simulation is enabled.
+int sampling_enabled();
+
+// Returns 1 if time is inside a detailed window.
+int sampling_detailed(UINT64 time);
+
+// Returns 1 if a thread has run inside a fast-forward since the previous call,
+// as it doesn't sync there. Called by the watcher under sync_mutex.
+int sampling_has_advanced();
+
+// Thread tid blocking at time. Called under sync_mutex.
+void sampling_block(THREADID tid, UINT64 time);
+
+// Thread tid woken up at time. Called under sync_mutex.
+void sampling_wake(THREADID tid, UINT64 time);
+
+// Print the estimates on stderr.
+void sampling_report();
+
+// Section writer of the per-window samples, see trace_bank_add_section.
+void sampling_dump(OUT_BUFFER *b);
+
+// Free allocated memory.
+void sampling_free();
+
+#endif // SAMPLING_H_
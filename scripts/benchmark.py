@@ -9,7 +9,9 @@ Will identify programs and tests, running all tests using different
 configurations, printing a result table in the end.
 '''
 
+from shared.runner import Runner
 from shared.testenv import Example, Shell, PINOCCHIO_BINARY
+import argparse
 
 SEPARATOR = "--- --- --- --- ---"
 
@@ -20,40 +22,38 @@ def header(name):
     _header += "\n" + SEPARATOR
     return _header
 
-def test_examples_must_finish(_examples):
+def run_examples(_examples, mode, timeout, runner):
+    ''' run all examples on mode, with all their jobs queued at once '''
+    for r in Example.run_all(_examples, mode, timeout, runner):
+        print r
+
+def test_examples_must_finish(_examples, runner):
     ''' all tests must finish under 5 seconds with different number
     of threads '''
 
     print header("Test: Examples must finish")
-    for ex in _examples:
-        print ex.must_finish(5)
+    run_examples(_examples, "native", 5, runner)
 
-def test_examples_must_finish_pin(_examples):
+def test_examples_must_finish_pin(_examples, runner):
     ''' all tests must finish under 1000 seconds with different number
     of threads using PINocchio '''
 
     print header("Test: Examples must finish with pin")
-    for ex in _examples:
-        if ex.finishes:
-            print ex.must_finish_pin(1000)
+    run_examples([ex for ex in _examples if ex.finishes], "pin", 1000, runner)
 
-def test_examples_must_finish_pin_with_time(_examples):
+def test_examples_must_finish_pin_with_time(_examples, runner):
     ''' all tests must finish under 1090 seconds with different number
     of threads using PINocchio with time option '''
 
     print header("Test: Examples must finish with pin using time option")
-    for ex in _examples:
-        if ex.finishes:
-            print ex.must_finish_pin_with_time(1000)
+    run_examples([ex for ex in _examples if ex.finishes], "time", 1000, runner)
 
-def test_examples_must_finish_pin_with_period(_examples):
+def test_examples_must_finish_pin_with_period(_examples, runner):
     ''' all tests must finish under 1000 seconds with different number
     of threads using PINocchio with period option '''
 
     print header("Test: Examples must finish with pin using period")
-    for ex in _examples:
-        if ex.finishes:
-            print ex.must_finish_pin_with_period(1000)
+    run_examples([ex for ex in _examples if ex.finishes], "period", 1000, runner)
 
 def print_result(_examples):
     ''' Print the result table, using information from all threads '''
@@ -82,32 +82,42 @@ def print_overhead_result(_examples):
 
 
 if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Run all examples with and without PINocchio.")
+    parser.add_argument("-j", "--jobs", type=int, default=1,
+                        help="executions running at the same time (default 1)")
+    parser.add_argument("-r", "--results", help="save every execution result as JSON")
+    args = parser.parse_args()
+
+    runner = Runner(args.jobs)
     programs = Shell.search_programs()
     examples = Shell.create_examples()
 
     # Test 1
-    test_examples_must_finish(examples)
+    test_examples_must_finish(examples, runner)
 
     # Test 2
     missing = Shell.check_dependencies(programs, ["pin", PINOCCHIO_BINARY])
     if len(missing) > 0:
         exit(1)
     else:
-        test_examples_must_finish_pin(examples)
+        test_examples_must_finish_pin(examples, runner)
 
     # Test 3
     missing = Shell.check_dependencies(programs, ["pin", PINOCCHIO_BINARY])
     if len(missing) > 0:
         print "Cant run test 3, missing dependencies: " + " ".join(missing)
     else:
-        test_examples_must_finish_pin_with_time(examples)
+        test_examples_must_finish_pin_with_time(examples, runner)
 
    # Test 4
     missing = Shell.check_dependencies(programs, ["pin", PINOCCHIO_BINARY])
     if len(missing) > 0:
         print "Cant run test 4, missing dependencies: " + " ".join(missing)
     else:
-        test_examples_must_finish_pin_with_period(examples)
+        test_examples_must_finish_pin_with_period(examples, runner)
+
+    if args.results:
+        runner.save(args.results)
 
     # Print results collected
     print_result(examples)
@@ -0,0 +1,50 @@
+''' bin2json.py
+Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+
+This software may be modified and distributed under the terms
+of the MIT license.  See the LICENSE file for details.
+
+Converts a binary trace (generated with -f binary) to the JSON schema,
+so it can be consumed by any tool expecting the regular output. With
+--window, only print samples of each thread inside [begin, end].
+'''
+
+import json
+import sys
+from shared.trace_binary import BinaryTrace
+
+def usage():
+    print "Usage: bin2json.py trace.bin [output.json] [--window begin end]"
+    exit(1)
+
+if __name__ == "__main__":
+    args = sys.argv[1:]
+    window = None
+
+    if "--window" in args:
+        i = args.index("--window")
+        if len(args) < i + 3:
+            usage()
+        window = (int(args[i+1]), int(args[i+2]))
+        args = args[:i] + args[i+3:]
+
+    if len(args) < 1:
+        usage()
+
+    trace = BinaryTrace(args[0])
+    if window is None:
+        data = trace.to_dict()
+    else:
+        data = {"end": trace.end, "unit": trace.unit, "threads": []}
+        for t in trace.threads:
+            data["threads"].append({
+                "pin-tid": t["pin-tid"],
+                "start": t["start"],
+                "samples": trace.window(t, window[0], window[1]),
+            })
+
+    if len(args) > 1:
+        with open(args[1], "w") as f:
+            json.dump(data, f)
+    else:
+        print json.dumps(data)
@@ -9,7 +9,6 @@ generated by PINocchio
 '''
 
 import matplotlib.pyplot as plt
-import json
 import sys
 from shared import trace
 
@@ -21,8 +20,7 @@ if __name__ == "__main__":
     if (len(sys.argv) > 1):
         filename = sys.argv[1]
 
-    with open(filename) as data_file:
-        data = json.load(data_file)
+    data = trace.load(filename)
 
     trace.validate(data)
     print "json parsed correctly, processing..."
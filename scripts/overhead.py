@@ -0,0 +1,156 @@
+''' overhead.py
+Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+
+This software may be modified and distributed under the terms
+of the MIT license.  See the LICENSE file for details.
+
+Overhead regression benchmark. Runs every example natively and under
+PINocchio (exact, -p and -t), recording wall times and the slowdown factor
+of the tool for each number of threads. Results are saved as JSON or CSV
+(by extension) and can be compared against a previously saved baseline,
+flagging slowdowns that grew beyond a threshold.
+'''
+
+from shared.runner import Runner
+from shared.testenv import Example, Shell, PINOCCHIO_BINARY
+import argparse
+import csv
+import json
+
+TOOL_MODES = ["pin", "period", "time"]
+FIELDS = ["name", "threads", "native", "pin", "period", "time",
+          "slowdown-pin", "slowdown-period", "slowdown-time"]
+
+def run(examples, repeat, runner):
+    ''' run all examples on all modes, returning the best wall time of each
+    (name, threads) and mode '''
+    walls = {}
+
+    for _ in range(repeat):
+        for r in Example.run_all(examples, "native", 5, runner):
+            print r
+
+        # No point measuring the tool on what doesn't finish by itself.
+        finished = [ex for ex in examples if ex.finishes]
+        for mode in TOOL_MODES:
+            for r in Example.run_all(finished, mode, 1000, runner):
+                print r
+
+    # Best of the repetitions, the least disturbed by the rest of the machine.
+    for job in runner.done:
+        if job.info.get("wall") is None:
+            continue
+        key = (job.name, job.info["threads"])
+        mode = job.info["mode"]
+        entry = walls.setdefault(key, {})
+        entry[mode] = min(entry.get(mode, job.info["wall"]), job.info["wall"])
+
+    return walls
+
+def records(walls):
+    ''' one record per (name, threads), with the slowdown of each tool mode '''
+    result = []
+    for (name, threads) in sorted(walls.keys()):
+        entry = walls[(name, threads)]
+        r = {"name": name, "threads": threads, "native": entry.get("native")}
+        for mode in TOOL_MODES:
+            r[mode] = entry.get(mode)
+            r["slowdown-" + mode] = None
+            if r["native"] and r[mode] is not None:
+                r["slowdown-" + mode] = r[mode] / r["native"]
+        result.append(r)
+    return result
+
+def save(filename, result):
+    ''' save records as CSV if filename ends with .csv, JSON otherwise '''
+    with open(filename, "w") as f:
+        if filename.endswith(".csv"):
+            w = csv.DictWriter(f, FIELDS)
+            w.writeheader()
+            for r in result:
+                w.writerow(dict((k, "" if v is None else v) for k, v in r.items()))
+        else:
+            json.dump(result, f, indent=2, sort_keys=True)
+
+def load(filename):
+    ''' load records saved by save '''
+    with open(filename) as f:
+        if not filename.endswith(".csv"):
+            return json.load(f)
+
+        result = []
+        for row in csv.DictReader(f):
+            r = {"name": row["name"], "threads": int(row["threads"])}
+            for k in FIELDS[2:]:
+                r[k] = float(row[k]) if row[k] != "" else None
+            result.append(r)
+        return result
+
+def compare(result, baseline, threshold):
+    ''' print slowdowns that grew more than threshold percent over the
+    baseline, returning how many '''
+    base = dict(((b["name"], b["threads"]), b) for b in baseline)
+    regressions = 0
+
+    for r in result:
+        b = base.get((r["name"], r["threads"]))
+        if b is None:
+            continue
+
+        for mode in TOOL_MODES:
+            new, old = r["slowdown-" + mode], b.get("slowdown-" + mode)
+            if new is None or not old:
+                continue
+
+            change = 100.0 * (new - old) / old
+            if change > threshold:
+                regressions += 1
+                print "REGRESSION: %s (%d threads) %s: %.2fx -> %.2fx (%+.1f%%)" % \
+                      (r["name"], r["threads"], mode, old, new, change)
+
+    return regressions
+
+def print_result(result):
+    ''' slowdown table, one line per example and number of threads '''
+    names = ["Name", "Threads", "Native", "Pin", "Period", "Time"]
+    table = []
+    for r in result:
+        line = [r["name"], r["threads"], "%.2f" % r["native"] if r["native"] is not None else "-"]
+        for mode in TOOL_MODES:
+            s = r["slowdown-" + mode]
+            line.append("%.2fx" % s if s is not None else "-")
+        table.append(line)
+
+    Example.print_table(names, table, 3)
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="PINocchio overhead regression benchmark.")
+    parser.add_argument("-o", "--output", default="overhead.json",
+                        help="results file, CSV if it ends with .csv (default overhead.json)")
+    parser.add_argument("-b", "--baseline", help="compare against a previously saved results file")
+    parser.add_argument("-t", "--threshold", type=float, default=10.0,
+                        help="slowdown growth flagged as regression, in percent (default 10)")
+    parser.add_argument("-n", "--repeat", type=int, default=1,
+                        help="runs of each configuration, keeping the fastest (default 1)")
+    parser.add_argument("-j", "--jobs", type=int, default=1,
+                        help="executions running at the same time (default 1)")
+    args = parser.parse_args()
+
+    programs = Shell.search_programs()
+    missing = Shell.check_dependencies(programs, ["pin", PINOCCHIO_BINARY])
+    if len(missing) > 0:
+        exit(1)
+
+    runner = Runner(args.jobs)
+    result = records(run(Shell.create_examples(), max(1, args.repeat), runner))
+
+    print_result(result)
+    save(args.output, result)
+    print "Results saved on " + args.output
+
+    if args.baseline:
+        regressions = compare(result, load(args.baseline), args.threshold)
+        if regressions > 0:
+            print str(regressions) + " regression(s) over " + args.baseline
+            exit(1)
+        print "No regressions over " + args.baseline
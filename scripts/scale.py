@@ -8,16 +8,17 @@ Performs scalability tests for an example, plotting how it would
 scale in terms of work|duration|efficiency versus number of threads.
 '''
 
+from shared.runner import Runner
 from shared.testenv import Example, Shell, PINOCCHIO_BINARY
+import argparse
 import matplotlib.pyplot as plt
-import sys
 
-def test_examples_must_finish(_examples):
+def test_examples_must_finish(_examples, runner):
     ''' all tests must finish under 5 seconds with different number
     of threads '''
 
     for ex in _examples:
-        print ex.must_finish(5)
+        print ex.must_finish(5, runner)
 
 def plot_result(_example):
     x = _example.threads
@@ -44,31 +45,36 @@ def plot_result(_example):
     plt.show()
 
 if __name__ == "__main__":
-    # If an argument, it's the filename
-    if (len(sys.argv) < 2):
-        print "Missing program name."
-        exit(1)
-
-    period = False
-    instrumented = sys.argv[-1]
+    parser = argparse.ArgumentParser(description="Scalability test of an example.")
+    parser.add_argument("-p", "--period", action="store_true", help="use a 1000-period")
+    parser.add_argument("-j", "--jobs", type=int, default=1,
+                        help="executions running at the same time (default 1)")
+    parser.add_argument("-r", "--results", help="save every execution result as JSON")
+    parser.add_argument("program", help="example binary, receiving the number of threads")
+    args = parser.parse_args()
 
-    # If there is any extra argument before it, assume period
-    if (len(sys.argv) > 2):
-        period = True
+    runner = Runner(args.jobs)
 
     programs = Shell.search_programs()
-    example = Shell.create_example(instrumented, no_binary_fail = True, quadratic = False)
+    example = Shell.create_example(args.program, no_binary_fail = True, quadratic = False)
 
     # Assert test run before loosing time.
-    test_examples_must_finish([example])
+    test_examples_must_finish([example], runner)
 
     missing = Shell.check_dependencies(programs, ["pin", PINOCCHIO_BINARY])
     if len(missing) > 0:
         exit(1)
 
-    if period:
-        example.scale_test_pin_with_period(100)
+    if args.period:
+        r = example.scale_test_pin_with_period(100, runner)
     else:
-        example.scale_test_pin(500)
+        r = example.scale_test_pin(500, runner)
+
+    if args.results:
+        runner.save(args.results)
+
+    if r is not None:
+        print r
+        exit(1)
 
     plot_result(example)
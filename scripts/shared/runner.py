@@ -0,0 +1,124 @@
+''' runner.py
+Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+
+This software may be modified and distributed under the terms
+of the MIT license.  See the LICENSE file for details.
+
+Job runner used by the test scripts. Independent commands are executed
+concurrently, a fixed number at a time, each one killed if it doesn't
+finish in time. Every job run is kept, so results of a whole sweep can be
+saved as a single JSON file.
+'''
+
+import json
+import os
+import Queue
+import signal
+import subprocess
+import threading
+import time
+
+class Job(object):
+    ''' A command to be run and its result, once done '''
+    def __init__(self, name, command, timeout, cwd=None, output=None):
+        self.name = name
+        self.command = command
+        self.timeout = timeout
+        self.cwd = cwd
+        self.output = output
+
+        # Free for the caller, saved along with the results
+        self.info = {}
+
+        self.returncode = None
+        self.stdout = None
+        self.stderr = None
+        self.timed_out = False
+        self.elapsed = None
+
+    def _kill(self, process):
+        ''' timer callback, kill it if still running '''
+        if process.poll() is None:
+            self.timed_out = True
+            # The whole group, children would keep the pipes open.
+            os.killpg(process.pid, signal.SIGKILL)
+
+    def run(self):
+        ''' run the command, blocking until it finishes or times out '''
+        start = time.time()
+        p = subprocess.Popen(self.command.split(), cwd=self.cwd,
+                             stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                             preexec_fn=os.setsid)
+
+        timer = threading.Timer(self.timeout, self._kill, [p])
+        timer.start()
+        try:
+            self.stdout, self.stderr = p.communicate()
+        finally:
+            timer.cancel()
+
+        self.elapsed = time.time() - start
+        self.returncode = None if self.timed_out else p.returncode
+
+    def to_dict(self):
+        ''' machine readable result, without the process output '''
+        result = {
+            "name": self.name,
+            "command": self.command,
+            "returncode": self.returncode,
+            "timed-out": self.timed_out,
+            "elapsed": self.elapsed,
+            "output": self.output,
+        }
+        result.update(self.info)
+        return result
+
+class Runner(object):
+    ''' Runs lists of jobs, up to jobs of them at the same time '''
+    def __init__(self, jobs=1, verbose=True):
+        self.jobs = max(1, jobs)
+        self.verbose = verbose
+        self.done = []
+        self._print_lock = threading.Lock()
+
+    def _worker(self, pending):
+        while True:
+            try:
+                job = pending.get_nowait()
+            except Queue.Empty:
+                return
+
+            if self.verbose:
+                with self._print_lock:
+                    print "  $ " + job.command
+            job.run()
+
+    def run(self, job_list):
+        ''' run all jobs, returning them in the same order once all finish '''
+        pending = Queue.Queue()
+        for job in job_list:
+            pending.put(job)
+
+        workers = []
+        for _ in range(min(self.jobs, len(job_list))):
+            w = threading.Thread(target=self._worker, args=(pending,))
+            w.daemon = True
+            w.start()
+            workers.append(w)
+
+        # Join with a timeout, so Ctrl-C still reaches the main thread.
+        for w in workers:
+            while w.is_alive():
+                w.join(1)
+
+        self.done += job_list
+        return job_list
+
+    def save(self, filename):
+        ''' save the results of every job run so far '''
+        directory = os.path.dirname(filename)
+        if directory != "" and not os.path.isdir(directory):
+            os.makedirs(directory)
+
+        with open(filename, "w") as f:
+            json.dump([job.to_dict() for job in self.done], f, indent=2, sort_keys=True)
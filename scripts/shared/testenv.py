@@ -10,16 +10,24 @@ from withing a python script
 '''
 
 from distutils.spawn import find_executable
+from shared.runner import Job, Runner
 from shared.trace import all_stats_from_file
 import os
-import subprocess
 import sys
-import time
 
 TOOLS_DIR = os.path.dirname(os.path.dirname(os.path.realpath(__file__)))
 PINOCCHIO_DIR = os.path.dirname(TOOLS_DIR)
 PINOCCHIO_BINARY = os.path.join(PINOCCHIO_DIR, "obj-intel64", "PINocchio.so")
 BINARY_DIR = os.path.join(PINOCCHIO_DIR, "obj-intel64")
+RUNS_DIR = os.path.join(TOOLS_DIR, "runs")
+
+# PINocchio flags of each mode, None when running without pin.
+MODES = {
+    "native": None,
+    "pin": "",
+    "time": "-t",
+    "period": "-p 1000",
+}
 
 NUM_TESTS = 6
 VERBOSE = True
@@ -44,22 +52,12 @@ class Shell(object):
     @staticmethod
     def execute(command, timeout):
         ''' execute a given command but kill if it doesn't finish in time '''
-        if VERBOSE:
-            print "  $ " + command
-
-        p = subprocess.Popen(command.split(), cwd=TOOLS_DIR, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
-        delay = 0.1
+        job = Job(command, command, timeout, cwd=TOOLS_DIR)
+        Runner(verbose=VERBOSE).run([job])
 
-        passed = 0
-        while p.poll() is None:
-            time.sleep(delay)
-            passed += delay
-            if passed > timeout:
-                p.kill()
-                return None, None, None
-
-        out, err = p.communicate()
-        return p.returncode, out, err
+        if job.returncode is None:
+            return None, None, None
+        return job.returncode, job.stdout, job.stderr
 
     @staticmethod
     def create_examples():
@@ -220,123 +218,124 @@ class Example(object):
             return " threads"
         return " thread"
 
-    def must_finish(self, timeout):
-        ''' attempt to run the example using different thread numbers '''
-        for t in self.threads:
-            r = self.run_once(timeout, t)
-            if r is not None:
-                return r
-
-        self.finishes = True
-        return self.name + ": Ok"
+    def _results(self, mode):
+        ''' list holding [wall, cpu] results of a mode '''
+        return {
+            "native": self.result,
+            "pin": self.result_with_pin,
+            "time": self.result_with_time,
+            "period": self.result_with_period,
+        }[mode]
+
+    def _set_finishes(self, mode):
+        ''' mark the example as finishing on mode '''
+        if mode == "native":
+            self.finishes = True
+        elif mode == "pin":
+            self.finishes_with_pin = True
+        elif mode == "time":
+            self.finishes_with_time = True
+        else:
+            self.finishes_with_period = True
 
-    def run_once(self, timeout, t):
-        ''' run the instrumented program only once with t threads '''
+    def job(self, mode, t, timeout):
+        ''' job running the example with t threads on mode, as given by MODES '''
+        output = None
+        if MODES[mode] is None:
+            command = self.path + " " + str(t)
+        else:
+            # Each run has its own output, so concurrent runs don't clobber each other.
+            output = os.path.join(RUNS_DIR, os.path.basename(self.name) + "-" + mode + "-" + str(t) + ".json")
+            command = "pin -t " + PINOCCHIO_BINARY + " -o " + output + " " + MODES[mode] + " -- "
+            command += self.path + " " + str(t)
 
-        command = self.path + " " + str(t)
-        r, stdout, _ = Shell.execute(command, timeout)
+        job = Job(self.name, command, timeout, cwd=TOOLS_DIR, output=output)
+        job.info = {"mode": mode, "threads": t}
+        return job
 
-        if r == None:
-            return self.name + ": Failed/timeout to finish with " + str(t) + self._threads_str(t)
+    def jobs(self, mode, timeout):
+        ''' one job per number of threads, running the example on mode '''
+        if not os.path.isdir(RUNS_DIR):
+            os.makedirs(RUNS_DIR)
 
-        if r != 0:
-            return self.name + ": Returned non-zero (" + str(r) + ") with " + str(t) + self._threads_str(t)
+        return [self.job(mode, t, timeout) for t in self.threads]
 
-        self.append_stdout_results(stdout, self.result)
-        return None
+    def collect(self, mode, jobs, stats=False):
+        ''' check finished jobs of mode, in threads order, storing their results.
+        Returns the message for the first failure, or Ok if all passed '''
+        for job in jobs:
+            t = job.info["threads"]
+            if job.returncode is None:
+                return self.name + ": Failed/timeout to finish with " + str(t) + self._threads_str(t)
 
-    def _append_stats_from_file(self):
-        work, max_duration, efficiency = all_stats_from_file(os.path.join(TOOLS_DIR, "trace.json"))
-        self.work.append(work)
-        self.max_duration.append(max_duration)
-        self.efficiency.append(efficiency)
+            if job.returncode != 0:
+                return self.name + ": Returned non-zero (" + str(job.returncode) + ") with " + str(t) + self._threads_str(t)
 
-    def scale_test_pin(self, timeout):
-        ''' run the example using different thread numbers and store scalability information '''
-        for t in self.threads:
-            r = self.run_once_pin(timeout, t)
-            if r is not None:
-                return r
+            results = self._results(mode)
+            self.append_stdout_results(job.stdout, results)
+            job.info["wall"], job.info["cpu"] = results[-1]
 
-            self._append_stats_from_file()
+            if job.output is not None and os.path.isfile(job.output):
+                work, max_duration, efficiency = all_stats_from_file(job.output)
+                job.info["work"] = work
+                job.info["duration"] = max_duration
+                job.info["efficiency"] = efficiency
 
-    def must_finish_pin(self, timeout):
-        ''' same as must_finish, but using pin and PINocchio, also calculates work '''
-        for t in self.threads:
-            r = self.run_once_pin(timeout, t)
-            if r is not None:
-                return r
+                if stats:
+                    self.work.append(work)
+                    self.max_duration.append(max_duration)
+                    self.efficiency.append(efficiency)
 
-        self.finishes_with_pin = True
+        self._set_finishes(mode)
         return self.name + ": Ok"
 
-    def run_once_pin(self, timeout, t):
-        ''' run the instrumented program only once with t threads under pin'''
-
-        command = "pin -t " + PINOCCHIO_BINARY + " -- " + self.path + " " + str(t)
-        r, stdout, _ = Shell.execute(command, timeout)
-
-        if r == None:
-            return self.name + ": Failed/timeout to finish with " + str(t) + self._threads_str(t)
-
-        if r != 0:
-            return self.name + ": Returned non-zero (" + str(r) + ") with " + str(t) + self._threads_str(t)
+    def run_mode(self, mode, timeout, runner=None, stats=False):
+        ''' run the example with every number of threads on mode '''
+        if runner is None:
+            runner = Runner(verbose=VERBOSE)
 
-        self.append_stdout_results(stdout, self.result_with_pin)
-        return None
+        return self.collect(mode, runner.run(self.jobs(mode, timeout)), stats)
 
-    def must_finish_pin_with_time(self, timeout):
-        ''' same as must_finish, but using pin and PINocchio with timed based (non-PRAM) option'''
-        for t in self.threads:
-            command = " pin -t " + PINOCCHIO_BINARY + " -t -- "
-            command += self.path + " " + str(t)
-            r, stdout, _ = Shell.execute(command, timeout)
-
-            if r == None:
-                return self.name + ": Failed/timeout to finish with " + str(t) + self._threads_str(t)
+    @staticmethod
+    def run_all(examples, mode, timeout, runner):
+        ''' run several examples on mode at once, so the runner can keep all
+        its jobs busy. Returns one message per example '''
+        jobs = [ex.jobs(mode, timeout) for ex in examples]
 
-            if r != 0:
-                return self.name + ": Returned non-zero (" + str(r) + ") with " + str(t) + self._threads_str(t)
+        all_jobs = []
+        for j in jobs:
+            all_jobs += j
+        runner.run(all_jobs)
 
-            self.append_stdout_results(stdout, self.result_with_time)
+        return [ex.collect(mode, j) for ex, j in zip(examples, jobs)]
 
-        self.finishes_with_time = True
-        return self.name + ": Ok"
+    def must_finish(self, timeout, runner=None):
+        ''' attempt to run the example using different thread numbers '''
+        return self.run_mode("native", timeout, runner)
 
-    def scale_test_pin_with_period(self, timeout):
+    def scale_test_pin(self, timeout, runner=None):
         ''' run the example using different thread numbers and store scalability information '''
-        for t in self.threads:
-            r = self.run_once_pin_with_period(timeout, t)
-            if r is not None:
-                return r
-
-            self._append_stats_from_file()
+        r = self.run_mode("pin", timeout, runner, stats=True)
+        if not self.finishes_with_pin:
+            return r
 
-    def run_once_pin_with_period(self, timeout, t):
-        ''' run the instrumented program only once with t threads under pin'''
-
-        command = " pin -t " + PINOCCHIO_BINARY + " -p 1000 -- "
-        command += self.path + " " + str(t)
-        r, stdout, _ = Shell.execute(command, timeout)
-
-        if r == None:
-            return self.name + ": Failed/timeout to finish with " + str(t) + self._threads_str(t)
+    def must_finish_pin(self, timeout, runner=None):
+        ''' same as must_finish, but using pin and PINocchio, also calculates work '''
+        return self.run_mode("pin", timeout, runner)
 
-        if r != 0:
-            return self.name + ": Returned non-zero (" + str(r) + ") with " + str(t) + self._threads_str(t)
+    def must_finish_pin_with_time(self, timeout, runner=None):
+        ''' same as must_finish, but using pin and PINocchio with timed based (non-PRAM) option'''
+        return self.run_mode("time", timeout, runner)
 
-        self.append_stdout_results(stdout, self.result_with_period)
-        return None
+    def scale_test_pin_with_period(self, timeout, runner=None):
+        ''' run the example using different thread numbers and store scalability information '''
+        r = self.run_mode("period", timeout, runner, stats=True)
+        if not self.finishes_with_period:
+            return r
 
-    def must_finish_pin_with_period(self, timeout):
+    def must_finish_pin_with_period(self, timeout, runner=None):
         ''' same as must_finish, but using pin and PINocchio with a 1000-period (approximate) option'''
-        for t in self.threads:
-            r = self.run_once_pin_with_period(timeout, t)
-            if r is not None:
-                return r
-
-        self.finishes_with_period = True
-        return self.name + ": Ok"
+        return self.run_mode("period", timeout, runner)
 
     @staticmethod
     def print_table(names, table, spacing):
@@ -8,6 +8,7 @@ Auxiliary functions regarding trace processing
 '''
 
 import json
+from shared import trace_binary
 
 def process_thread(thread):
     ''' Generate information regarding one thread: left positions,
@@ -65,10 +66,23 @@ def all_stats(_threads):
 
     return _work, _max_duration, _efficiency
 
-def all_stats_from_file(filename):
-    ''' All work but from a trace file '''
+def load(filename):
+    ''' Load a trace file, either JSON or binary, as the JSON structure '''
+    if trace_binary.is_binary(filename):
+        return trace_binary.BinaryTrace(filename).to_dict()
+
     with open(filename) as data_file:
-        data = json.load(data_file)
+        return json.load(data_file)
+
+def all_stats_from_file(filename):
+    ''' All work but from a trace file, using the summary computed by
+    the tool when present '''
+    data = load(filename)
+
+    # -stats-only output is the summary itself.
+    summary = data.get("summary", data if "work" in data else None)
+    if summary is not None:
+        return summary["work"], summary["duration"], summary["efficiency"]
 
     return all_stats(data["threads"])
 
@@ -0,0 +1,146 @@
+''' trace_binary.py
+Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+
+This software may be modified and distributed under the terms
+of the MIT license.  See the LICENSE file for details.
+
+Reader for the compact binary trace (see trace_binary.h). Provides the
+whole trace using the same schema of the JSON output and a time window
+query that only decodes the blocks of interest.
+'''
+
+import struct
+from bisect import bisect_right
+
+MAGIC = b"PNOTRACE"
+VERSION = 2
+
+# Names of WAKE_CAUSE values (see thread.h)
+CAUSES = ["none", "mutex", "semaphore", "rwlock", "cond", "join", "create"]
+
+def is_binary(filename):
+    ''' check if a given file starts with the binary trace magic '''
+    with open(filename, "rb") as f:
+        return f.read(len(MAGIC)) == MAGIC
+
+def _read_varint(data, pos):
+    ''' decode a varint starting on pos, returns value and next position '''
+    value = 0
+    shift = 0
+    while True:
+        b = data[pos]
+        pos += 1
+        value |= (b & 0x7f) << shift
+        if b < 0x80:
+            return value, pos
+        shift += 7
+
+class BinaryTrace(object):
+    ''' Parsed header and thread table of a binary trace, blocks are only
+    decoded on demand '''
+    def __init__(self, filename):
+        with open(filename, "rb") as f:
+            self.data = bytearray(f.read())
+
+        data = self.data
+        if bytes(data[0:8]) != MAGIC or bytes(data[-8:]) != MAGIC:
+            raise ValueError("not a PINocchio binary trace: " + filename)
+
+        version, self.end, self.block_size = struct.unpack_from("<IQI", data, 8)
+        # Version 1 had no wake ups, it's otherwise the same.
+        if version not in (1, VERSION):
+            raise ValueError("unsupported binary trace version: " + str(version))
+        self.version = version
+        unit_len = data[24]
+        self.unit = bytes(data[25:25 + unit_len]).decode("ascii")
+
+        pos = struct.unpack_from("<Q", data, len(data) - 16)[0]
+        count = struct.unpack_from("<I", data, pos)[0]
+        pos += 4
+
+        self.threads = []
+        for _ in range(count):
+            pin_tid, start, samples, blocks, index_offset = struct.unpack_from("<IQQIQ", data, pos)
+            pos += 32
+
+            index = []
+            for b in range(blocks):
+                index.append(struct.unpack_from("<QQI", data, index_offset + 20 * b))
+
+            self.threads.append({
+                "pin-tid": pin_tid,
+                "start": start,
+                "samples": samples,
+                "index": index,
+                "first_times": [i[0] for i in index],
+            })
+
+    def _decode_block(self, entry):
+        ''' decode one block, returns a list of [time, status], with
+        waker, object and cause appended on wake ups '''
+        _, offset, count = entry
+        data = self.data
+
+        status = []
+        for i in range(count):
+            status.append((data[offset + i // 4] >> (2 * (i % 4))) & 0x3)
+
+        pos = offset + (count + 3) // 4
+        samples = []
+        time = 0
+        for i in range(count):
+            delta, pos = _read_varint(data, pos)
+            time += delta
+            samples.append([time, status[i]])
+
+        if self.version < 2:
+            return samples
+
+        wakes = pos
+        pos += (count + 7) // 8
+        for i in range(count):
+            if data[wakes + i // 8] & (1 << (i % 8)):
+                waker, pos = _read_varint(data, pos)
+                obj, pos = _read_varint(data, pos)
+                cause = CAUSES[data[pos]] if data[pos] < len(CAUSES) else "none"
+                pos += 1
+                samples[i] += [waker, obj, cause]
+
+        return samples
+
+    def samples(self, thread):
+        ''' all samples of a given thread entry '''
+        samples = []
+        for entry in thread["index"]:
+            samples += self._decode_block(entry)
+        return samples
+
+    def window(self, thread, begin, end):
+        ''' samples of a thread that describe the interval [begin, end]: the
+        one in effect at begin plus every change until end '''
+        first = max(bisect_right(thread["first_times"], begin) - 1, 0)
+
+        samples = []
+        for entry in thread["index"][first:]:
+            if entry[0] > end:
+                break
+            samples += self._decode_block(entry)
+
+        # Drop what precedes the sample in effect at begin.
+        keep = 0
+        for i in range(len(samples)):
+            if samples[i][0] <= begin:
+                keep = i
+        return [s for s in samples[keep:] if s[0] <= end]
+
+    def to_dict(self):
+        ''' convert to the same structure json.load gives for a JSON trace '''
+        threads = []
+        for t in self.threads:
+            threads.append({
+                "pin-tid": t["pin-tid"],
+                "start": t["start"],
+                "samples": self.samples(t),
+            })
+
+        return {"end": self.end, "unit": self.unit, "threads": threads}
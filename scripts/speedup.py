@@ -0,0 +1,35 @@
+''' speedup.py
+Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+
+This software may be modified and distributed under the terms
+of the MIT license.  See the LICENSE file for details.
+
+Compares a baseline trace with one generated with -speedup-region, printing
+the predicted change in end-to-end duration of optimizing that region.
+'''
+
+import sys
+from shared import trace
+
+def usage():
+    print "Usage: speedup.py baseline.json speedup.json"
+    exit(1)
+
+if __name__ == "__main__":
+    if len(sys.argv) < 3:
+        usage()
+
+    baseline = trace.load(sys.argv[1])
+    virtual = trace.load(sys.argv[2])
+
+    before = trace.duration(baseline["threads"])
+    after = trace.duration(virtual["threads"])
+
+    if "speedup" in virtual:
+        region = virtual["speedup"]
+        print "Region:       " + region["region"] + " (" + str(region["percent"]) + "% faster)"
+        print "Instructions: " + str(region["instructions"]) + " charged as " + str(region["charged"])
+
+    print "Baseline:     " + str(before) + " " + baseline["unit"]
+    print "Virtual:      " + str(after) + " " + virtual["unit"]
+    print "Predicted:    " + "%+.2f%%" % (100.0 * (after - before) / before)
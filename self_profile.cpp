@@ -0,0 +1,205 @@
+/* self_profile.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "self_profile.h"
+#include "sync_cost.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <iostream>
+
+#define REPORT_ACTIONS 10           // Actions printed, by time holding sync_mutex
+
+typedef struct {
+    UINT64 calls[SYNC_COST_ACTIONS];
+    UINT64 held[SYNC_COST_ACTIONS]; // Ticks holding sync_mutex, per action
+    UINT64 wait;                    // Ticks waiting for sync_mutex
+    UINT64 contended;
+    UINT64 parks;
+    UINT64 parked;                  // Ticks parked on the semaphore
+} THREAD_SELF;
+
+typedef struct {
+    UINT64 calls;
+    UINT64 ticks;
+} SECTION_SELF;
+
+// Action and its totals, used for sorting.
+typedef struct {
+    int action;
+    UINT64 calls;
+    UINT64 held;
+} ENTRY;
+
+static int enabled;
+static struct timespec start_clock;
+static UINT64 start_tsc;
+
+static THREAD_SELF threads[MAX_THREADS];
+static SECTION_SELF sections[SELF_TOTAL_SECTIONS];
+
+static int running;
+static UINT64 unparks;
+static UINT64 running_since;
+static UINT64 running_first;
+static double running_area;         // Running threads integrated over ticks
+
+static const char *section_names[SELF_TOTAL_SECTIONS] = {"update", "filter", "dump"};
+
+void self_profile_init()
+{
+    enabled = knob_self_profile.Value() ? 1 : 0;
+    memset(threads, 0, sizeof(threads));
+    memset(sections, 0, sizeof(sections));
+    running = 0;
+    unparks = 0;
+    running_since = 0;
+    running_first = 0;
+    running_area = 0;
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_clock);
+    start_tsc = self_profile_now();
+}
+
+int self_profile_enabled()
+{
+    return enabled;
+}
+
+void self_profile_sync(THREADID tid, int action, UINT64 start, UINT64 locked, UINT64 released,
+                       UINT64 resumed, int contended, int parked)
+{
+    if(enabled == 0 || action < 0 || action >= SYNC_COST_ACTIONS) {
+        return;
+    }
+
+    THREAD_SELF *t = &threads[tid];
+    t->calls[action]++;
+    t->held[action] += released - locked;
+    t->wait += locked - start;
+    t->contended += contended;
+    if(parked > 0) {
+        t->parks++;
+        t->parked += resumed - released;
+    }
+}
+
+void self_profile_section(SELF_SECTION section, UINT64 start)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    sections[section].calls++;
+    sections[section].ticks += self_profile_now() - start;
+}
+
+void self_profile_running(int delta)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    UINT64 now = self_profile_now();
+    if(running_first == 0) {
+        running_first = now;
+    } else {
+        running_area += (double) running * (now - running_since);
+    }
+    running_since = now;
+
+    if(delta > 0) {
+        unparks++;
+    }
+    running = running + delta > 0 ? running + delta : 0;
+}
+
+static int compare_entries(const void *a, const void *b)
+{
+    const ENTRY *x = (const ENTRY *) a;
+    const ENTRY *y = (const ENTRY *) b;
+    if(x->held == y->held) {
+        return 0;
+    }
+    return x->held < y->held ? 1 : -1;
+}
+
+void self_profile_report()
+{
+    static ENTRY entries[SYNC_COST_ACTIONS];
+
+    if(enabled == 0) {
+        return;
+    }
+
+    // TSC rate from the clock elapsed since init.
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    UINT64 ticks = self_profile_now() - start_tsc;
+    double wall = (double)(now.tv_sec - start_clock.tv_sec) * 1e9 + (now.tv_nsec - start_clock.tv_nsec);
+    double ns = ticks > 0 ? wall / ticks : 0;
+
+    UINT64 calls = 0, held = 0, wait = 0, contended = 0, parks = 0, parked = 0;
+    for(int a = 0; a < SYNC_COST_ACTIONS; a++) {
+        entries[a].action = a;
+        entries[a].calls = 0;
+        entries[a].held = 0;
+    }
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_SELF *t = &threads[i];
+        for(int a = 0; a < SYNC_COST_ACTIONS; a++) {
+            entries[a].calls += t->calls[a];
+            entries[a].held += t->held[a];
+        }
+        wait += t->wait;
+        contended += t->contended;
+        parks += t->parks;
+        parked += t->parked;
+    }
+    for(int a = 0; a < SYNC_COST_ACTIONS; a++) {
+        calls += entries[a].calls;
+        held += entries[a].held;
+    }
+
+    cerr << "[PINocchio] Self profile: " << wall / 1e6 << " ms wall, TSC at " << (ns > 0 ? 1 / ns : 0) << " GHz" << std::endl;
+    cerr << "[PINocchio]   sync_mutex: " << calls << " acquires, " << (calls > 0 ? 100.0 * contended / calls : 0)
+         << "% contended, " << wait * ns / 1e6 << " ms waiting, held " << held * ns / 1e6 << " ms ("
+         << (ticks > 0 ? 100.0 * held / ticks : 0) << "% of wall)" << std::endl;
+    cerr << "[PINocchio]   parks: " << parks << ", " << parked * ns / 1e6 << " ms parked, unparks: " << unparks << std::endl;
+    if(running_since > running_first) {
+        cerr << "[PINocchio]   average running host threads: " << running_area / (running_since - running_first) << std::endl;
+    }
+    for(int s = 0; s < SELF_TOTAL_SECTIONS; s++) {
+        cerr << "[PINocchio]   trace bank " << section_names[s] << ": " << sections[s].calls << " calls, "
+             << sections[s].ticks * ns / 1e6 << " ms" << std::endl;
+    }
+
+    qsort(entries, SYNC_COST_ACTIONS, sizeof(ENTRY), compare_entries);
+    for(int a = 0; a < REPORT_ACTIONS && entries[a].calls > 0; a++) {
+        cerr << "[PINocchio]   " << sync_cost_name(entries[a].action) << ": " << entries[a].calls << " calls, "
+             << entries[a].held * ns / 1e6 << " ms held, " << (UINT64)(entries[a].held * ns / entries[a].calls) << " ns avg" << std::endl;
+    }
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        THREAD_SELF *t = &threads[i];
+        UINT64 thread_calls = 0, thread_held = 0;
+        for(int a = 0; a < SYNC_COST_ACTIONS; a++) {
+            thread_calls += t->calls[a];
+            thread_held += t->held[a];
+        }
+        if(thread_calls == 0) {
+            continue;
+        }
+        cerr << "[PINocchio]   thread " << print_id(i) << ": " << thread_calls << " syncs, "
+             << t->wait * ns / 1e6 << " ms waiting, " << thread_held * ns / 1e6 << " ms held, "
+             << t->parks << " parks, " << t->parked * ns / 1e6 << " ms parked" << std::endl;
+    }
+}
@@ -0,0 +1,69 @@
+/* self_profile.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef SELF_PROFILE_H_
+#define SELF_PROFILE_H_
+
+/*
+Profile of the tool itself (-self-profile), to tell where a slow run spends
+its time. Intervals are measured with the TSC, converted to ns at exit using
+the clock elapsed since init.
+
+Each sync call is split in three parts: waiting for sync_mutex, handling the
+action while holding it, and parked on the thread semaphore afterwards. They
+are kept per thread and per action, along with how often sync_mutex was
+already taken. Trace bank updates (downsampling included), downsampling
+itself (filter) and the final dump are timed as well, all of them under
+sync_mutex or at exit.
+
+Host threads are counted as running unless parked on their semaphore, and
+the count is integrated over time to give the average concurrency. The share
+of the wall time with sync_mutex held is the serialized part of the tool;
+what isn't on any of those goes to the application and to Pin (JIT and
+analysis calls).
+*/
+
+#include "pin.H"
+
+typedef enum {
+    SELF_TRACE_UPDATE = 0,
+    SELF_TRACE_FILTER = 1,
+    SELF_TRACE_DUMP = 2,
+    SELF_TOTAL_SECTIONS = 3,
+} SELF_SECTION;
+
+// Read knobs and start the clock.
+void self_profile_init();
+
+// Returns 1 if the tool is profiling itself.
+int self_profile_enabled();
+
+// Current TSC.
+static inline UINT64 self_profile_now()
+{
+    UINT32 low, high;
+    __asm__ __volatile__("rdtsc" : "=a"(low), "=d"(high));
+    return ((UINT64) high << 32) | low;
+}
+
+// One sync call of tid: started at start, got sync_mutex at locked (after
+// waiting on it if contended), released it at released and resumed at resumed.
+void self_profile_sync(THREADID tid, int action, UINT64 start, UINT64 locked, UINT64 released,
+                       UINT64 resumed, int contended, int parked);
+
+// Time spent on a trace bank section since start. Called under sync_mutex.
+void self_profile_section(SELF_SECTION section, UINT64 start);
+
+// Running host threads changed by delta (a park, unpark, start or exit).
+// Called under sync_mutex.
+void self_profile_running(int delta);
+
+// Print the profile on stderr.
+void self_profile_report();
+
+#endif // SELF_PROFILE_H_
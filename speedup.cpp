@@ -0,0 +1,208 @@
+/* speedup.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "speedup.h"
+#include "trace_bank.h"
+#include "thread.h"
+#include "knob.h"
+#include "log.h"
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+#define CHARGE_UNIT 100             // Charges are kept in hundredths
+
+typedef enum {
+    REGION_NONE = 0,
+    REGION_FUNC = 1,                // func:NAME
+    REGION_LINE = 2,                // line:FILE:LINE
+    REGION_ADDR = 3,                // addr:START-END
+}   REGION_TYPE;
+
+typedef struct {
+    UINT64 instructions;            // Region instructions executed, weighted by the cost model
+    UINT64 charged;                 // What they added to ins_count
+    UINT32 fraction;                // Charge not added yet, in hundredths
+} REGION_COUNT;
+
+static REGION_TYPE type;
+static string func;
+static string file;
+static INT32 line;
+static ADDRINT low;
+static ADDRINT high;
+
+static UINT32 cost;                 // Charge of one region instruction, in hundredths
+static REGION_COUNT counts[MAX_THREADS];
+
+// Does path end with the given file name?
+static int same_file(const string &path, const string &name)
+{
+    if(path.size() < name.size()) {
+        return 0;
+    }
+    return path.compare(path.size() - name.size(), name.size(), name) == 0;
+}
+
+static int parse_region(const string &region)
+{
+    if(region.compare(0, 5, "func:") == 0 && region.size() > 5) {
+        type = REGION_FUNC;
+        func = region.substr(5);
+        return 0;
+    }
+
+    if(region.compare(0, 5, "line:") == 0) {
+        size_t colon = region.rfind(':');
+        if(colon <= 5) {
+            return -1;
+        }
+        type = REGION_LINE;
+        file = region.substr(5, colon - 5);
+        line = atoi(region.substr(colon + 1).c_str());
+        return line > 0 ? 0 : -1;
+    }
+
+    if(region.compare(0, 5, "addr:") == 0) {
+        char *end;
+        type = REGION_ADDR;
+        low = (ADDRINT) strtoull(region.c_str() + 5, &end, 0);
+        if(*end != '-') {
+            return -1;
+        }
+        high = (ADDRINT) strtoull(end + 1, &end, 0);
+        return *end == '\0' && low < high ? 0 : -1;
+    }
+
+    return -1;
+}
+
+int speedup_init()
+{
+    type = REGION_NONE;
+    memset(counts, 0, sizeof(counts));
+
+    if(knob_speedup_region.Value() == "") {
+        return 0;
+    }
+
+    if(parse_region(knob_speedup_region.Value()) < 0) {
+        cerr << "[PINocchio] Error: Invalid speedup region: " << knob_speedup_region.Value() << std::endl;
+        return -1;
+    }
+
+    // At 100% region instructions would be free and time would stop there.
+    int percent = knob_speedup.Value();
+    if(percent < 0 || percent >= 100) {
+        cerr << "[PINocchio] Error: Speedup should be a percentage from 0 to 99: " << percent << std::endl;
+        return -1;
+    }
+    cost = CHARGE_UNIT - percent;
+
+    trace_bank_add_section("speedup", speedup_dump);
+    cerr << "[PINocchio] Virtual speedup of " << percent << "% on " << knob_speedup_region.Value() << std::endl;
+    return 0;
+}
+
+int speedup_enabled()
+{
+    return type != REGION_NONE;
+}
+
+int speedup_in_region(INS ins)
+{
+    switch(type) {
+    case REGION_FUNC: {
+        RTN rtn = INS_Rtn(ins);
+        return RTN_Valid(rtn) && RTN_Name(rtn) == func;
+    }
+
+    case REGION_LINE: {
+        INT32 column, ins_line;
+        string ins_file;
+        PIN_GetSourceLocation(INS_Address(ins), &column, &ins_line, &ins_file);
+        return ins_line == line && same_file(ins_file, file);
+    }
+
+    case REGION_ADDR:
+        return INS_Address(ins) >= low && INS_Address(ins) < high;
+
+    default:
+        return 0;
+    }
+}
+
+UINT64 speedup_charge(THREADID tid, UINT32 weight)
+{
+    REGION_COUNT *c = &counts[tid];
+
+    c->instructions += weight;
+    c->fraction += cost * weight;
+
+    UINT64 charge = c->fraction / CHARGE_UNIT;
+    c->fraction -= charge * CHARGE_UNIT;
+    c->charged += charge;
+    return charge;
+}
+
+static void totals(UINT64 *instructions, UINT64 *charged)
+{
+    *instructions = 0;
+    *charged = 0;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        *instructions += counts[i].instructions;
+        *charged += counts[i].charged;
+    }
+}
+
+void speedup_report()
+{
+    UINT64 instructions, charged;
+
+    if(type == REGION_NONE) {
+        return;
+    }
+
+    totals(&instructions, &charged);
+    cerr << "[PINocchio] Speedup region: " << instructions << " instructions charged as " << charged
+         << " (" << instructions - charged << " saved)" << std::endl;
+}
+
+void speedup_dump(OUT_BUFFER *b)
+{
+    UINT64 instructions, charged;
+
+    totals(&instructions, &charged);
+
+    out_buffer_str(b, "{\"region\": \"");
+    out_buffer_escaped(b, knob_speedup_region.Value().c_str());
+    out_buffer_str(b, "\", \"percent\":");
+    out_buffer_u64(b, CHARGE_UNIT - cost);
+    out_buffer_str(b, ", \"instructions\":");
+    out_buffer_u64(b, instructions);
+    out_buffer_str(b, ", \"charged\":");
+    out_buffer_u64(b, charged);
+    out_buffer_str(b, ", \"per-thread\": [");
+
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        if(counts[i].instructions == 0) {
+            continue;
+        }
+
+        out_buffer_str(b, first > 0 ? "{\"pin-tid\":" : ", {\"pin-tid\":");
+        first = 0;
+        out_buffer_u64(b, print_id(i));
+        out_buffer_str(b, ", \"instructions\":");
+        out_buffer_u64(b, counts[i].instructions);
+        out_buffer_str(b, ", \"charged\":");
+        out_buffer_u64(b, counts[i].charged);
+        out_buffer_char(b, '}');
+    }
+    out_buffer_str(b, "]}");
+}
@@ -0,0 +1,43 @@
+/* speedup.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef SPEEDUP_H_
+#define SPEEDUP_H_
+
+/*
+Virtual speedup: what-if experiments in simulated time. Instructions inside a
+region (a function, a source line or an address range) are charged at a
+reduced rate, so running the same program with and without it predicts the
+end-to-end effect of optimizing that region (see scripts/speedup.py).
+
+Charges are kept in hundredths of instruction per thread, so fractional costs
+add up exactly without floating point on the instrumentation path.
+*/
+
+#include "out_buffer.h"
+#include "pin.H"
+
+// Parse -speedup-region and -speedup. Returns 0 on success, -1 if invalid.
+int speedup_init();
+
+// Returns 1 if a region was given.
+int speedup_enabled();
+
+// Returns 1 if ins belongs to the region.
+int speedup_in_region(INS ins);
+
+// Account one region instruction of tid costing weight, returning how much to charge.
+UINT64 speedup_charge(THREADID tid, UINT32 weight);
+
+// Print region totals on stderr.
+void speedup_report();
+
+// Section writer of the region totals, see trace_bank_add_section.
+void speedup_dump(OUT_BUFFER *b);
+
+#endif // SPEEDUP_H_
@@ -0,0 +1,258 @@
+/* stats.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "stats.h"
+#include "trace_bank.h"
+#include "out_buffer.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <iostream>
+
+// A thread starting (+1) or stopping (-1) to run.
+typedef struct {
+    UINT64 time;
+    int delta;
+} EVENT;
+
+static int compare_events(const void *a, const void *b)
+{
+    const EVENT *x = (const EVENT *) a;
+    const EVENT *y = (const EVENT *) b;
+
+    if(x->time == y->time) {
+        return 0;
+    }
+    return x->time < y->time ? -1 : 1;
+}
+
+// Sweep the changes of all threads in time order, adding each interval to
+// the number of threads running during it.
+static void compute_profile(STATS *s)
+{
+    int total = 0;
+
+    memset(s->profile, 0, sizeof(s->profile));
+    s->has_profile = 0;
+    s->max_running = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr != NULL) {
+            if(tr->changes == NULL) {
+                return;
+            }
+            total += tr->total_changes;
+        }
+    }
+
+    EVENT *events = (EVENT *) malloc((total + 1) * sizeof(EVENT));
+    if(events == NULL) {
+        cerr << "[PINocchio] Error: Out of memory on parallelism profile." << std::endl;
+        return;
+    }
+
+    int used = 0;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        // Only transitions matter, repeated statuses are skipped.
+        int running = 0;
+        for(int j = 0; j < tr->total_changes; j++) {
+            int now = tr->changes[j].status == UNLOCKED ? 1 : 0;
+            if(now != running) {
+                events[used].time = tr->changes[j].time;
+                events[used].delta = now - running;
+                used++;
+                running = now;
+            }
+        }
+    }
+
+    qsort(events, used, sizeof(EVENT), compare_events);
+
+    int running = 0;
+    for(int i = 0; i < used; i++) {
+        if(i > 0 && running >= 0 && running <= MAX_THREADS) {
+            s->profile[running] += events[i].time - events[i - 1].time;
+        }
+        running += events[i].delta;
+    }
+
+    for(int i = 0; i <= MAX_THREADS; i++) {
+        if(s->profile[i] > 0) {
+            s->max_running = i;
+        }
+    }
+    s->has_profile = 1;
+    free(events);
+}
+
+void stats_compute(STATS *s)
+{
+    s->work = 0;
+    s->duration = 0;
+    s->span = 0;
+    s->threads = 0;
+    s->efficiency = 0;
+    s->parallelism = 0;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        s->work += tr->work;
+        s->threads++;
+        if(tr->span > s->span) {
+            s->span = tr->span;
+        }
+    }
+
+    // Thread 0 starts and finishes everyone, so it's both first and last.
+    P_TRACE *main = trace_bank_get(0);
+    if(main != NULL) {
+        s->duration = main->last_time;
+    }
+
+    if(s->duration > 0 && s->threads > 0) {
+        s->efficiency = s->work / ((double) s->duration * s->threads);
+    }
+    if(s->span > 0) {
+        s->parallelism = (double) s->work / s->span;
+    }
+
+    compute_profile(s);
+}
+
+void stats_print(STATS *s, const char *unit)
+{
+    cerr << "[PINocchio] Total Work:  " << s->work << " " << unit << std::endl;
+    cerr << "[PINocchio] Duration:    " << s->duration << " " << unit << std::endl;
+    cerr << "[PINocchio] Span:        " << s->span << " " << unit << std::endl;
+    cerr << "[PINocchio] Threads:     " << s->threads << std::endl;
+    cerr << "[PINocchio] Efficiency:  " << s->efficiency << std::endl;
+    cerr << "[PINocchio] Parallelism: " << s->parallelism << std::endl;
+
+    if(s->has_profile == 0 || s->duration == 0) {
+        return;
+    }
+    for(int i = 0; i <= s->max_running; i++) {
+        if(s->profile[i] > 0) {
+            cerr << "[PINocchio]   " << i << " running: " << 100.0 * s->profile[i] / s->duration << "%" << std::endl;
+        }
+    }
+}
+
+static void dump_double(OUT_BUFFER *b, double v)
+{
+    char str[32];
+    snprintf(str, sizeof(str), "%.6f", v);
+    out_buffer_str(b, str);
+}
+
+static void dump_field(OUT_BUFFER *b, const char *name, UINT64 v)
+{
+    out_buffer_str(b, "\"");
+    out_buffer_str(b, name);
+    out_buffer_str(b, "\":");
+    out_buffer_u64(b, v);
+}
+
+// Fields shared by both outputs, each one after sep.
+static void dump_summary(OUT_BUFFER *b, STATS *s, const char *sep)
+{
+    dump_field(b, "work", s->work);
+    out_buffer_str(b, sep);
+    dump_field(b, "duration", s->duration);
+    out_buffer_str(b, sep);
+    dump_field(b, "span", s->span);
+    out_buffer_str(b, sep);
+    dump_field(b, "threads", s->threads);
+    out_buffer_str(b, sep);
+    out_buffer_str(b, "\"efficiency\":");
+    dump_double(b, s->efficiency);
+    out_buffer_str(b, sep);
+    out_buffer_str(b, "\"parallelism\":");
+    dump_double(b, s->parallelism);
+    out_buffer_str(b, sep);
+
+    // Time with i threads running, for i from 0 on.
+    out_buffer_str(b, "\"profile\":");
+    if(s->has_profile == 0) {
+        out_buffer_str(b, "null");
+        return;
+    }
+    out_buffer_char(b, '[');
+    for(int i = 0; i <= s->max_running; i++) {
+        out_buffer_str(b, i > 0 ? ", " : "");
+        out_buffer_u64(b, s->profile[i]);
+    }
+    out_buffer_char(b, ']');
+}
+
+void stats_write(OUT_BUFFER *b, STATS *s)
+{
+    out_buffer_str(b, "{");
+    dump_summary(b, s, ", ");
+    out_buffer_str(b, "}");
+}
+
+void stats_dump(const char *filename, const char *unit)
+{
+    static OUT_BUFFER b;
+    STATS s;
+
+    stats_compute(&s);
+    stats_print(&s, unit);
+
+    if(out_buffer_open(&b, filename) < 0) {
+        cerr << "[PINocchio] Error: Can't open stats output: " << filename << std::endl;
+        return;
+    }
+
+    out_buffer_str(&b, "{\n  \"unit\": \"");
+    out_buffer_str(&b, unit);
+    out_buffer_str(&b, "\",\n  ");
+    dump_summary(&b, &s, ",\n  ");
+    out_buffer_str(&b, ",\n  \"per-thread\": [");
+
+    int first = 1;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        out_buffer_str(&b, first > 0 ? "\n    {" : ",\n    {");
+        first = 0;
+
+        dump_field(&b, "pin-tid", print_id(i));
+        out_buffer_str(&b, ", ");
+        dump_field(&b, "start", tr->start);
+        out_buffer_str(&b, ", ");
+        dump_field(&b, "end", tr->end);
+        out_buffer_str(&b, ", ");
+        dump_field(&b, "work", tr->work);
+        out_buffer_str(&b, ", ");
+        dump_field(&b, "locked", tr->locked);
+        out_buffer_str(&b, ", ");
+        dump_field(&b, "blocks", tr->blocks);
+        out_buffer_char(&b, '}');
+    }
+
+    out_buffer_str(&b, "\n  ]");
+    trace_bank_dump_sections(&b);
+    out_buffer_str(&b, "\n}\n");
+    out_buffer_close(&b);
+}
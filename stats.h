@@ -0,0 +1,54 @@
+/* stats.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef STATS_H_
+#define STATS_H_
+
+/*
+Execution statistics computed from trace_bank running totals, following the
+same definitions as scripts/shared/trace.py:all_stats.
+
+The parallelism profile is the time spent with exactly N threads UNLOCKED,
+found with a single sweep over the changes of all threads. It's not
+available with -stats-only, as changes are not kept.
+
+The span is the longest chain of UNLOCKED time, following thread creations
+and wake ups, with the waits left out, a lower bound of the duration on any
+number of processors. trace_bank keeps it as a running total of each thread.
+*/
+
+#include "thread.h"
+#include "out_buffer.h"
+#include "pin.H"
+
+typedef struct {
+    UINT64 work;                    // Sum of UNLOCKED time of all threads
+    UINT64 duration;                // Last change of thread 0
+    UINT64 span;                    // Longest chain of work, see above
+    int threads;                    // Registered threads
+    double efficiency;              // work / (duration * threads)
+    double parallelism;             // work / span
+
+    int has_profile;
+    int max_running;                // Last non zero entry of profile
+    UINT64 profile[MAX_THREADS + 1];
+} STATS;
+
+// Compute current statistics.
+void stats_compute(STATS *s);
+
+// Print statistics on stderr.
+void stats_print(STATS *s, const char *unit);
+
+// Write statistics as a JSON object, used as a section of the full output.
+void stats_write(OUT_BUFFER *b, STATS *s);
+
+// Write statistics and per-thread totals as a small JSON.
+void stats_dump(const char *filename, const char *unit);
+
+#endif // STATS_H_
@@ -11,6 +11,10 @@
 #include "sync.h"
 #include "lock_hash.h"
 #include "thread.h"
+#include "sync_cost.h"
+#include "self_profile.h"
+#include "record.h"
+#include "sampling.h"
 #include "log.h"
 
 // Used to only allow one thread to sync
@@ -32,7 +36,8 @@ VOID static watcher(VOID *arg)
         PIN_Sleep(WATCHER_SLEEP * 1000);
 
         PIN_MutexLock(&sync_mutex);
-        if(thread_has_advanced() <= 0) {
+        // A long fast-forward doesn't sync, but its threads still run.
+        if(thread_has_advanced() <= 0 && sampling_has_advanced() <= 0) {
             cerr << "[Pinocchio] Execution is stopped, likely due unsupported locking function" << std::endl;
             fail();
         }
@@ -52,6 +57,7 @@ void sync_init(int pram)
 
     create_lock.busy = 0;
     create_lock.locked = NULL;
+    create_lock.cause = CAUSE_CREATE;
 
     // Lastly, init thread, trace bank and exec tracker structures and start watcher.
     if(pram > 0) {
@@ -65,10 +71,37 @@ void sync_init(int pram)
     thread_init(pram);
 }
 
+// Charge the sync call itself. It's contended if it blocked the thread or
+// woke someone. A blocked thread is charged on wake up, as its time is
+// replaced by the waker's then.
+static void charge_sync_cost(ACTION *action, UINT64 wakes)
+{
+    THREAD_INFO *t = &all_threads[action->tid];
+    int blocked = t->status == LOCKED ? 1 : 0;
+
+    UINT32 cost = sync_cost_action(action->action_type, blocked > 0 || thread_total_wakes() > wakes);
+    if(blocked > 0) {
+        t->sync_cost += cost;
+    } else {
+        t->ins_count += cost;
+    }
+}
+
 void sync(ACTION *action)
 {
+    // Taken before anything is charged on this call.
+    record_enter(action);
+
     // Only one thread should be working at each time.
-    PIN_MutexLock(&sync_mutex);
+    int profile = self_profile_enabled();
+    UINT64 start = profile > 0 ? self_profile_now() : 0;
+    int contended = 0;
+    if(!PIN_MutexTryLock(&sync_mutex)) {
+        PIN_MutexLock(&sync_mutex);
+        contended = 1;
+    }
+    UINT64 locked = profile > 0 ? self_profile_now() : 0;
+    UINT64 wakes = thread_total_wakes();
 
     switch(action->action_type) {
     case ACTION_DONE:
@@ -138,13 +171,14 @@ void sync(ACTION *action)
         if(action->tid > 0) {
             THREAD_INFO *t = handle_thread_exit(all_threads[action->tid].create_value);
             for(; t != NULL; t = t->next_lock) {
-                thread_unlock(t, &all_threads[action->tid]);
+                thread_unlock(t, &all_threads[action->tid], (void *) all_threads[action->tid].create_value, CAUSE_JOIN);
             }
         }
 
         // Check if all threads have finished
         if(thread_all_finished() == 1) {
             DEBUG(cerr << "[Sync] Program finished." << std::endl);
+            record_sync(action, creator_pin_tid);
             return;
         }
 
@@ -169,7 +203,7 @@ void sync(ACTION *action)
 
     case ACTION_TRY_LOCK:
         // Pass the value back to try_lock function.
-        action->arg.i = handle_try_lock(action->arg.p_1);
+        action->arg.i = handle_try_lock(action->arg.p_1, action->tid);
         break;
 
     case ACTION_UNLOCK:
@@ -248,15 +282,42 @@ void sync(ACTION *action)
     case ACTION_COND_WAIT:
         handle_cond_wait(action->arg.p_1, action->arg.p_2, action->tid);
         break;
+
+    case ACTION_COUNT:
+        break;
+    }
+
+    record_sync(action, creator_pin_tid);
+
+    // Plain steps are free, only hooked calls have a cost.
+    if(action->action_type != ACTION_DONE && sync_cost_enabled() > 0) {
+        charge_sync_cost(action, wakes);
+    }
+
+    // Stops running if it has to wait, a finished thread is gone. Counted
+    // before the release below, which counts it back if it goes on.
+    if(profile > 0 && (!PIN_SemaphoreIsSet(&all_threads[action->tid].active) ||
+                       action->action_type == ACTION_FINI)) {
+        self_profile_running(-1);
     }
 
     // Once the big switch has finished, all threads are updated.
     // Try to release whoever possible.
     thread_try_release_all();
 
+    // Parked unless released on this same call.
+    int parked = PIN_SemaphoreIsSet(&all_threads[action->tid].active) ? 0 : 1;
+
     // Release sync_mutex so other thread can sync.
+    UINT64 released = profile > 0 ? self_profile_now() : 0;
     PIN_MutexUnlock(&sync_mutex);
 
     // Should sleep here if not synced.
     PIN_SemaphoreWait(&all_threads[action->tid].active);
+    record_exit(action);
+
+    if(profile > 0) {
+        self_profile_sync(action->tid, action->action_type, start, locked, released, self_profile_now(),
+                          contended, parked);
+    }
 }
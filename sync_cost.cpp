@@ -0,0 +1,203 @@
+/* sync_cost.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "sync_cost.h"
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+typedef struct {
+    uint32_t uncontended;
+    uint32_t contended;
+
+    uint64_t calls;
+    uint64_t contended_calls;
+    uint64_t cycles;
+} SYNC_COST;
+
+// Same order as ACTION_TYPE.
+static const char *names[] = {
+    "done", "register", "fini", "lock-destroy", "lock-init", "lock", "try-lock", "unlock",
+    "create", "join", "after-create", "sem-destroy", "sem-getvalue", "sem-init", "sem-post",
+    "sem-trywait", "sem-wait", "rwlock-init", "rwlock-destroy", "rwlock-rdlock",
+    "rwlock-tryrdlock", "rwlock-wrlock", "rwlock-trywrlock", "rwlock-unlock",
+    "cond-broadcast", "cond-destroy", "cond-init", "cond-signal", "cond-wait",
+};
+
+// Fails to compile when an action is added without its name.
+typedef char names_match_actions[sizeof(names) / sizeof(names[0]) == ACTION_COUNT ? 1 : -1];
+
+typedef struct {
+    const char *name;
+    uint32_t uncontended;
+    uint32_t contended;
+} DEFAULT_ENTRY;
+
+// Rough costs of glibc pthreads over futex: an atomic when uncontended, a
+// futex syscall when it has to sleep or wake someone.
+static const DEFAULT_ENTRY default_table[] = {
+    {"lock", 20, 120},
+    {"try-lock", 20, 20},
+    {"unlock", 20, 100},
+    {"create", 5000, 5000},
+    {"join", 40, 120},
+    {"sem-post", 20, 100},
+    {"sem-wait", 20, 120},
+    {"sem-trywait", 20, 20},
+    {"rwlock-rdlock", 25, 120},
+    {"rwlock-tryrdlock", 25, 25},
+    {"rwlock-wrlock", 25, 120},
+    {"rwlock-trywrlock", 25, 25},
+    {"rwlock-unlock", 25, 100},
+    {"cond-broadcast", 30, 150},
+    {"cond-signal", 30, 100},
+    {"cond-wait", 60, 150},
+};
+
+#define DEFAULT_CREATE 10000
+#define DEFAULT_WAKE 500
+
+static int enabled;
+static SYNC_COST costs[SYNC_COST_ACTIONS];
+static uint32_t create_latency;
+static uint32_t wake_latency;
+
+static int find_action(const char *name)
+{
+    for(int i = 0; i < SYNC_COST_ACTIONS; i++) {
+        if(strcmp(names[i], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int load_file(const char *filename)
+{
+    char line[256];
+    char name[64];
+    unsigned uncontended, contended;
+    int number = 0;
+
+    FILE *f = fopen(filename, "r");
+    if(f == NULL) {
+        std::cerr << "[PINocchio] Error: Can't open sync cost table: " << filename << std::endl;
+        return -1;
+    }
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        number++;
+
+        char *comment = strchr(line, '#');
+        if(comment != NULL) {
+            *comment = '\0';
+        }
+
+        int fields = sscanf(line, "%63s %u %u", name, &uncontended, &contended);
+        if(fields <= 0) {
+            continue;
+        }
+
+        int action = find_action(name);
+        int ok = fields >= 2 ? 0 : -1;
+        if(ok == 0 && strcmp(name, "create-latency") == 0) {
+            create_latency = uncontended;
+        } else if(ok == 0 && strcmp(name, "wake-latency") == 0) {
+            wake_latency = uncontended;
+        } else if(ok == 0 && action >= 0) {
+            costs[action].uncontended = uncontended;
+            costs[action].contended = fields == 3 ? contended : uncontended;
+        } else {
+            ok = -1;
+        }
+
+        if(ok < 0) {
+            std::cerr << "[PINocchio] Error: Invalid sync cost entry on " << filename << ":" << number << std::endl;
+            fclose(f);
+            return -1;
+        }
+    }
+
+    fclose(f);
+    return 0;
+}
+
+int sync_cost_init(const char *table)
+{
+    enabled = 0;
+    memset(costs, 0, sizeof(costs));
+    create_latency = 0;
+    wake_latency = 0;
+
+    if(table[0] == '\0') {
+        return 0;
+    }
+
+    if(strcmp(table, "default") == 0) {
+        for(unsigned i = 0; i < sizeof(default_table) / sizeof(default_table[0]); i++) {
+            int action = find_action(default_table[i].name);
+            costs[action].uncontended = default_table[i].uncontended;
+            costs[action].contended = default_table[i].contended;
+        }
+        create_latency = DEFAULT_CREATE;
+        wake_latency = DEFAULT_WAKE;
+    } else if(load_file(table) < 0) {
+        return -1;
+    }
+
+    enabled = 1;
+    std::cerr << "[PINocchio] Sync cost table " << table << " loaded" << std::endl;
+    return 0;
+}
+
+int sync_cost_enabled()
+{
+    return enabled;
+}
+
+const char *sync_cost_name(int action)
+{
+    return action >= 0 && action < SYNC_COST_ACTIONS ? names[action] : "unknown";
+}
+
+uint32_t sync_cost_action(int action, int contended)
+{
+    SYNC_COST *c = &costs[action];
+    uint32_t cost = contended > 0 ? c->contended : c->uncontended;
+
+    c->calls++;
+    c->contended_calls += contended > 0 ? 1 : 0;
+    c->cycles += cost;
+    return cost;
+}
+
+uint32_t sync_cost_create()
+{
+    return create_latency;
+}
+
+uint32_t sync_cost_wake()
+{
+    return wake_latency;
+}
+
+void sync_cost_report()
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    for(int i = 0; i < SYNC_COST_ACTIONS; i++) {
+        SYNC_COST *c = &costs[i];
+        if(c->cycles == 0) {
+            continue;
+        }
+        std::cerr << "[PINocchio] Sync cost " << names[i] << ": " << c->calls << " calls ("
+                  << c->contended_calls << " contended), " << c->cycles << " cycles" << std::endl;
+    }
+}
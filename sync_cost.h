@@ -0,0 +1,58 @@
+/* sync_cost.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef SYNC_COST_H_
+#define SYNC_COST_H_
+
+/*
+Cost of the synchronization calls themselves, in cycles. Hooks replace the
+real pthread functions, so without it a lock or a sem_post is free. Each
+ACTION_TYPE has an uncontended and a contended cost: a call is contended when
+it blocked the thread (charged when it wakes up) or woke someone else. Thread
+creation adds a latency before the new thread starts, and every wake up adds
+a latency on top of the waker's time.
+
+-sync-cost selects the table: empty (default) charges nothing, "default" uses
+the built-in table for futex based pthreads and anything else is a file with
+one entry per line ('#' starts a comment):
+
+  NAME UNCONTENDED [CONTENDED]  e.g. lock 20 120
+  create-latency CYCLES
+  wake-latency CYCLES
+
+Names are the ones in sync_cost_name, e.g. lock, unlock, sem-wait, cond-wait.
+It doesn't depend on Pin, so it can be used by standalone tools as well.
+*/
+
+#include <stdint.h>
+#include "sync_types.h"
+
+#define SYNC_COST_ACTIONS ACTION_COUNT
+
+// Load a table, "" disables it. Returns 0 on success, -1 otherwise.
+int sync_cost_init(const char *table);
+
+// Returns 1 if a table was loaded.
+int sync_cost_enabled();
+
+// Name of an action on the table.
+const char *sync_cost_name(int action);
+
+// Cost of an action, counting it for the report.
+uint32_t sync_cost_action(int action, int contended);
+
+// Latency between pthread_create and the new thread start.
+uint32_t sync_cost_create();
+
+// Latency between a release and the woken thread running.
+uint32_t sync_cost_wake();
+
+// Print the cycles charged per action on stderr.
+void sync_cost_report();
+
+#endif // SYNC_COST_H_
@@ -0,0 +1,70 @@
+/* sync_types.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef SYNC_TYPES_H_
+#define SYNC_TYPES_H_
+
+/*
+Types shared by the tool and the standalone tools, so it doesn't depend on
+Pin. Tables indexed by action are sized with ACTION_COUNT.
+*/
+
+#define MAX_THREADS 256               // Max number of spawned threads by application
+
+typedef enum {
+    UNLOCKED = 0,     // Running other stuff free
+    LOCKED = 1,       // Waiting within a lock
+    UNREGISTERED = 2, // Not registered yet, must use message
+    FINISHED = 3,     // Already finished its job
+}   THREAD_STATUS;
+
+typedef enum {
+    ACTION_DONE = 0,
+    ACTION_REGISTER = 1,
+    ACTION_FINI = 2,
+    ACTION_LOCK_DESTROY = 3,
+    ACTION_LOCK_INIT = 4,
+    ACTION_LOCK = 5,
+    ACTION_TRY_LOCK = 6,
+    ACTION_UNLOCK = 7,
+    ACTION_BEFORE_CREATE = 8,
+    ACTION_BEFORE_JOIN = 9,
+    ACTION_AFTER_CREATE = 10,
+    ACTION_SEM_DESTROY = 11,
+    ACTION_SEM_GETVALUE = 12,
+    ACTION_SEM_INIT = 13,
+    ACTION_SEM_POST = 14,
+    ACTION_SEM_TRYWAIT = 15,
+    ACTION_SEM_WAIT = 16,
+    ACTION_RWLOCK_INIT = 17,
+    ACTION_RWLOCK_DESTROY = 18,
+    ACTION_RWLOCK_RDLOCK = 19,
+    ACTION_RWLOCK_TRYRDLOCK = 20,
+    ACTION_RWLOCK_WRLOCK = 21,
+    ACTION_RWLOCK_TRYWRLOCK = 22,
+    ACTION_RWLOCK_UNLOCK = 23,
+    ACTION_COND_BROADCAST = 24,
+    ACTION_COND_DESTROY = 25,
+    ACTION_COND_INIT = 26,
+    ACTION_COND_SIGNAL = 27,
+    ACTION_COND_WAIT = 28,
+    ACTION_COUNT                    // Number of actions, keep it last
+} ACTION_TYPE;
+
+// What released a LOCKED thread, saved with its wake up on the trace.
+typedef enum {
+    CAUSE_NONE = 0,       // Not a wake up
+    CAUSE_MUTEX = 1,
+    CAUSE_SEMAPHORE = 2,
+    CAUSE_RWLOCK = 3,
+    CAUSE_COND = 4,
+    CAUSE_JOIN = 5,
+    CAUSE_CREATE = 6,     // Lock serializing pthread_create
+}   WAKE_CAUSE;
+
+#endif // SYNC_TYPES_H_
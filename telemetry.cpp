@@ -0,0 +1,349 @@
+/* telemetry.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "telemetry.h"
+#include "trace_bank.h"
+#include "sync.h"
+#include "top.h"
+#include "uthash.h"
+#include "knob.h"
+#include "log.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <iostream>
+
+#define TELEMETRY_POLL_MS 100       // Checks for a dump request in between snapshots
+#define TELEMETRY_TOP_OBJECTS 5
+#define TELEMETRY_BUFFER 65536
+#define SOCKET_PREFIX "unix:"
+
+// Wake ups through an object, a thread had to block on it.
+typedef struct _OBJECT_WAITS OBJECT_WAITS;
+struct _OBJECT_WAITS {
+    void *key;
+    WAKE_CAUSE cause;
+    UINT64 waits;
+
+    UT_hash_handle hh;
+};
+
+typedef struct {
+    THREADID tid;
+    THREAD_STATUS status;
+    UINT64 ins;
+    UINT64 work;
+    UINT64 locked;
+    UINT64 blocks;
+} THREAD_SNAPSHOT;
+
+static int enabled;
+static string target;
+static int is_socket;
+static int sock;
+static UINT32 period_ms;
+static string partial_file;
+static volatile int dump_requested;
+
+static OBJECT_WAITS *objects;
+
+// Copied under sync_mutex, written out after releasing it.
+static THREAD_SNAPSHOT threads[MAX_THREADS];
+static int total_threads;
+static OBJECT_WAITS top[TELEMETRY_TOP_OBJECTS];
+static int total_top;
+
+static struct timespec start_clock;
+static double last_seconds;
+static UINT64 last_ins;
+
+static char text[TELEMETRY_BUFFER];
+static size_t used;
+
+static const char *status_names[] = {"running", "locked", "unregistered", "finished"};
+
+static double seconds()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (now.tv_sec - start_clock.tv_sec) + (now.tv_nsec - start_clock.tv_nsec) / 1e9;
+}
+
+// Take sync_mutex as the watcher does, backing off once the process exits.
+static int lock_sync()
+{
+    PIN_MutexLock(&sync_mutex);
+    if(PIN_IsProcessExiting()) {
+        PIN_MutexUnlock(&sync_mutex);
+        return -1;
+    }
+    return 0;
+}
+
+// Copy what is published, called under sync_mutex.
+static void copy_state()
+{
+    total_threads = 0;
+    for(THREADID i = 0; i <= max_tid && i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL || all_threads[i].status == UNREGISTERED) {
+            continue;
+        }
+
+        THREAD_SNAPSHOT *t = &threads[total_threads++];
+        t->tid = i;
+        t->status = all_threads[i].status;
+        t->ins = all_threads[i].ins_count;
+        t->work = tr->work;
+        t->locked = tr->locked;
+        t->blocks = tr->blocks;
+    }
+
+    TOP most;
+    top_init(&most, TELEMETRY_TOP_OBJECTS);
+    for(OBJECT_WAITS *o = objects; o != NULL; o = (OBJECT_WAITS *) o->hh.next) {
+        top_offer(&most, o, o->waits);
+    }
+
+    // Copied, as waits keep changing once sync_mutex is released.
+    total_top = most.total;
+    for(int i = 0; i < total_top; i++) {
+        top[i] = *(OBJECT_WAITS *) most.items[i];
+    }
+}
+
+static void append(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(&text[used], sizeof(text) - used, format, args);
+    va_end(args);
+
+    if(n > 0) {
+        used = used + n < sizeof(text) ? used + n : sizeof(text) - 1;
+    }
+}
+
+static void format_snapshot(double now)
+{
+    UINT64 ins_min = 0, ins_max = 0, ins_total = 0;
+    int running = 0, locked = 0, finished = 0, first = 1;
+
+    for(int i = 0; i < total_threads; i++) {
+        THREAD_SNAPSHOT *t = &threads[i];
+        ins_total += t->ins;
+        if(t->ins > ins_max) {
+            ins_max = t->ins;
+        }
+
+        if(t->status == UNLOCKED) {
+            ins_min = first > 0 || t->ins < ins_min ? t->ins : ins_min;
+            first = 0;
+            running++;
+        } else if(t->status == LOCKED) {
+            locked++;
+        } else if(t->status == FINISHED) {
+            finished++;
+        }
+    }
+
+    double rate = now > last_seconds && ins_total > last_ins ? (ins_total - last_ins) / (now - last_seconds) : 0;
+    last_seconds = now;
+    last_ins = ins_total;
+
+    used = 0;
+    append("{\"time-s\":%.3f, \"ins-min\":%llu, \"ins-max\":%llu, \"ins-per-second\":%.1f, "
+           "\"running\":%d, \"locked\":%d, \"finished\":%d, \"threads\":[",
+           now, (unsigned long long) ins_min, (unsigned long long) ins_max, rate, running, locked, finished);
+
+    for(int i = 0; i < total_threads; i++) {
+        THREAD_SNAPSHOT *t = &threads[i];
+        append("%s{\"pin-tid\":%u, \"status\":\"%s\", \"ins\":%llu, \"work\":%llu, \"locked\":%llu, \"blocks\":%llu}",
+               i > 0 ? ", " : "", print_id(t->tid), status_names[t->status], (unsigned long long) t->ins,
+               (unsigned long long) t->work, (unsigned long long) t->locked, (unsigned long long) t->blocks);
+    }
+
+    append("], \"contended\":[");
+    for(int i = 0; i < total_top; i++) {
+        append("%s{\"object\":\"%p\", \"cause\":\"%s\", \"waits\":%llu}", i > 0 ? ", " : "", top[i].key,
+               wake_cause_name(top[i].cause), (unsigned long long) top[i].waits);
+    }
+    append("]}\n");
+}
+
+static void publish_socket()
+{
+    if(sock < 0) {
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, target.c_str() + strlen(SOCKET_PREFIX), sizeof(addr.sun_path) - 1);
+
+        sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(sock >= 0 && connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+            close(sock);
+            sock = -1;
+        }
+        if(sock < 0) {
+            // Nobody listening yet, try again on the next snapshot.
+            return;
+        }
+    }
+
+    if(send(sock, text, used, MSG_NOSIGNAL) < 0) {
+        close(sock);
+        sock = -1;
+    }
+}
+
+static void publish_file()
+{
+    string tmp = target + ".tmp";
+    FILE *f = fopen(tmp.c_str(), "w");
+    if(f == NULL) {
+        return;
+    }
+    fwrite(text, 1, used, f);
+    fclose(f);
+    rename(tmp.c_str(), target.c_str());
+}
+
+static void snapshot()
+{
+    if(lock_sync() < 0) {
+        return;
+    }
+    copy_state();
+    PIN_MutexUnlock(&sync_mutex);
+
+    format_snapshot(seconds());
+    if(is_socket > 0) {
+        publish_socket();
+    } else {
+        publish_file();
+    }
+}
+
+static void partial_dump()
+{
+    if(lock_sync() < 0) {
+        return;
+    }
+    trace_bank_dump_partial(partial_file.c_str());
+    PIN_MutexUnlock(&sync_mutex);
+
+    cerr << "[PINocchio] Partial trace dumped to " << partial_file << std::endl;
+}
+
+VOID static telemetry_thread(VOID *arg)
+{
+    UINT32 elapsed = 0;
+
+    while(!PIN_IsProcessExiting()) {
+        PIN_Sleep(TELEMETRY_POLL_MS);
+        elapsed += TELEMETRY_POLL_MS;
+
+        if(dump_requested > 0) {
+            dump_requested = 0;
+            partial_dump();
+        }
+        if(elapsed >= period_ms) {
+            elapsed = 0;
+            snapshot();
+        }
+    }
+}
+
+// Only flag it, dumping from the signal context isn't safe.
+static BOOL on_signal(THREADID tid, INT32 sig, CONTEXT *ctxt, BOOL has_handler,
+                      const EXCEPTION_INFO *info, VOID *v)
+{
+    dump_requested = 1;
+    return FALSE;
+}
+
+int telemetry_init()
+{
+    enabled = knob_telemetry.Value() != "" ? 1 : 0;
+    objects = NULL;
+    sock = -1;
+    dump_requested = 0;
+    last_seconds = 0;
+    last_ins = 0;
+
+    if(enabled == 0) {
+        return 0;
+    }
+
+    if(knob_telemetry_period.Value() <= 0) {
+        cerr << "[PINocchio] Error: Telemetry period should be positive: " << knob_telemetry_period.Value() << std::endl;
+        return -1;
+    }
+    period_ms = knob_telemetry_period.Value() * 1000;
+
+    target = knob_telemetry.Value();
+    is_socket = target.compare(0, strlen(SOCKET_PREFIX), SOCKET_PREFIX) == 0 ? 1 : 0;
+    partial_file = knob_output_file.Value() + ".partial";
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start_clock);
+
+    THREADID tid = PIN_SpawnInternalThread(telemetry_thread, 0, 0, NULL);
+    if(tid == INVALID_THREADID) {
+        cerr << "[PINocchio] Error: Can't start telemetry thread." << std::endl;
+        return -1;
+    }
+    log_add_internal(tid);
+
+    PIN_InterceptSignal(SIGUSR1, on_signal, 0);
+    return 0;
+}
+
+int telemetry_enabled()
+{
+    return enabled;
+}
+
+void telemetry_wake(void *object, WAKE_CAUSE cause)
+{
+    if(enabled == 0) {
+        return;
+    }
+
+    OBJECT_WAITS *o;
+    HASH_FIND_PTR(objects, &object, o);
+    if(o == NULL) {
+        o = (OBJECT_WAITS *) malloc(sizeof(OBJECT_WAITS));
+        if(o == NULL) {
+            cerr << "[PINocchio] Error: Out of memory on telemetry." << std::endl;
+            fail();
+        }
+        o->key = object;
+        o->cause = cause;
+        o->waits = 0;
+        HASH_ADD_PTR(objects, key, o);
+    }
+    o->waits++;
+}
+
+void telemetry_free()
+{
+    if(sock >= 0) {
+        close(sock);
+        sock = -1;
+    }
+
+    OBJECT_WAITS *o, *tmp;
+    HASH_ITER(hh, objects, o, tmp) {
+        HASH_DEL(objects, o);
+        free(o);
+    }
+}
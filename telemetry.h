@@ -0,0 +1,44 @@
+/* telemetry.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/*
+Live progress of long runs (-telemetry TARGET). An internal thread, like the
+watcher, publishes a snapshot every -telemetry-period seconds: simulated
+time (lowest and highest instruction count among running threads), host
+progress in instructions per second, status and counts of each thread and
+the objects threads blocked on the most. Each snapshot is one JSON line. A
+TARGET of unix:PATH sends it to a Unix socket listening on PATH, anything
+else is a file rewritten on every snapshot (through a rename, so readers
+never see it half written).
+
+While telemetry runs, SIGUSR1 is taken from the application and triggers a
+partial trace dump on the output file name plus ".partial".
+
+State is copied under sync_mutex, so application threads are only stopped
+while the snapshot is taken, not while it's written.
+*/
+
+#include "thread.h"
+#include "pin.H"
+
+// Parse telemetry knobs and start its thread. Returns 0 on success, -1 if invalid.
+int telemetry_init();
+
+// Returns 1 if telemetry is running.
+int telemetry_enabled();
+
+// A thread blocked on object was released. Called under sync_mutex.
+void telemetry_wake(void *object, WAKE_CAUSE cause);
+
+// Free allocated memory.
+void telemetry_free();
+
+#endif // TELEMETRY_H_
@@ -12,11 +12,18 @@
 #include "trace_bank.h"
 #include "log.h"
 #include "exec_tracker.h"
+#include "critical_path.h"
+#include "sync_cost.h"
+#include "offcpu.h"
+#include "self_profile.h"
+#include "telemetry.h"
+#include "sampling.h"
 
 // Current thread status
 THREAD_INFO *all_threads;
 THREADID max_tid;
 static int pram;
+static UINT64 total_wakes;
 
 void thread_init(int _pram)
 {
@@ -24,10 +31,12 @@ void thread_init(int _pram)
     all_threads = (THREAD_INFO *) malloc(MAX_THREADS * sizeof(THREAD_INFO));
     max_tid = 0;
     pram = _pram;
+    total_wakes = 0;
 
     for(int i = 0; i < MAX_THREADS; i++) {
         all_threads[i].ins_count = 0;
         all_threads[i].sync_holder = 0;
+        all_threads[i].sync_cost = 0;
         all_threads[i].pin_tid = i;
 
         all_threads[i].status = UNREGISTERED;
@@ -39,6 +48,7 @@ void thread_init(int _pram)
     }
 
     trace_bank_init(pram);
+    critical_path_init(pram);
     exec_tracker_init();
     DEBUG(cerr << "[Thread] Threads structure initialized" << std::endl);
 }
@@ -86,6 +96,7 @@ void thread_try_release_all()
     for(THREAD_INFO *t = exec_tracker_awake(); t != NULL; t = exec_tracker_awake()) {
         // Release thread semaphore, that's all required to let thread continue.
         PIN_SemaphoreSet(&t->active);
+        self_profile_running(1);
     }
 }
 
@@ -98,21 +109,25 @@ void thread_start(THREAD_INFO *target, THREAD_INFO *creator)
 
     // Thread 0 is special, will pass NULL and starts with 0.
     // Other threads should start running and should be awake at first round.
-    target->ins_count = creator != NULL ? creator->ins_count : 0;
+    target->ins_count = creator != NULL ? creator->ins_count + sync_cost_create() : 0;
     target->status = UNLOCKED;
-    trace_bank_register(target->pin_tid, target->ins_count);
+    trace_bank_register(target->pin_tid, target->ins_count, creator != NULL ? creator->pin_tid : INVALID_THREADID,
+                        creator != NULL ? creator->ins_count : 0);
+    critical_path_create(target->pin_tid, creator != NULL ? creator->pin_tid : INVALID_THREADID, target->ins_count);
 
     // Thread start running or a deadlock might happen.
     // If, for some reason, there is someone really advanced, next sync
     // will stop anything important.
     exec_tracker_plus();
     PIN_SemaphoreSet(&target->active);
+    self_profile_running(1);
 }
 
 void thread_finish(THREAD_INFO *target)
 {
     target->status = FINISHED;
     trace_bank_finish(target->pin_tid, target->ins_count);
+    critical_path_finish(target->pin_tid, target->ins_count);
 
     exec_tracker_minus();
 }
@@ -127,11 +142,14 @@ void thread_lock(THREAD_INFO *target)
 
     target->status = LOCKED;
     trace_bank_update(target->pin_tid, target->ins_count, LOCKED);
+    offcpu_block(target->pin_tid, target->ins_count);
+    sampling_block(target->pin_tid, target->ins_count);
+    critical_path_block(target->pin_tid, target->ins_count);
 
     exec_tracker_minus();
 }
 
-void thread_unlock(THREAD_INFO *target, THREAD_INFO *unlocker)
+void thread_unlock(THREAD_INFO *target, THREAD_INFO *unlocker, void *object, WAKE_CAUSE cause)
 {
     target->status = UNLOCKED;
 
@@ -140,7 +158,17 @@ void thread_unlock(THREAD_INFO *target, THREAD_INFO *unlocker)
     if(unlocker->ins_count > target->ins_count) {
         target->ins_count = unlocker->ins_count;
     }
-    trace_bank_update(target->pin_tid, target->ins_count, UNLOCKED);
+
+    // Wake up latency, plus the cost of the call that blocked it.
+    target->ins_count += sync_cost_wake() + target->sync_cost;
+    target->sync_cost = 0;
+    total_wakes++;
+
+    trace_bank_wake(target->pin_tid, target->ins_count, unlocker->pin_tid, unlocker->ins_count, object, cause);
+    critical_path_wake(target->pin_tid, target->ins_count, unlocker->pin_tid, unlocker->ins_count, object, cause);
+    offcpu_wake(target->pin_tid, target->ins_count, cause);
+    sampling_wake(target->pin_tid, target->ins_count);
+    telemetry_wake(object, cause);
 
     exec_tracker_insert(target);
 }
@@ -159,6 +187,11 @@ int thread_has_advanced()
     return exec_tracker_changed();
 }
 
+UINT64 thread_total_wakes()
+{
+    return total_wakes;
+}
+
 void print_threads()
 {
     const char *status[] = {"UNLOCKED", "LOCKED", "UNREGISTERED", "FINISHED"};
@@ -9,20 +9,12 @@
 #ifndef THREAD_H_
 #define THREAD_H_
 
-#define MAX_THREADS 256               // Max number of spawned threads by application
-
 #include <pthread.h>
+#include "sync_types.h"
 #include "pin.H"
 
 // --- Thread info ---
 
-typedef enum {
-    UNLOCKED = 0,     // Running other stuff free
-    LOCKED = 1,       // Waiting within a lock
-    UNREGISTERED = 2, // Not registered yet, must use message
-    FINISHED = 3,     // Already finished its job
-}   THREAD_STATUS;
-
 // Holds information of a given thread
 typedef struct _THREAD_INFO THREAD_INFO;
 struct _THREAD_INFO {
@@ -39,6 +31,7 @@ struct _THREAD_INFO {
 
 
     THREAD_STATUS status;           // Current Status of executing and step
+    UINT64 sync_cost;               // Cost of a sync call that blocked, charged on wake up
 
     _THREAD_INFO *next_lock;        // Linked list, used if on a lock queue (lock_hash)
 
@@ -69,12 +62,16 @@ void thread_finish(THREAD_INFO *target);
 
 void thread_lock(THREAD_INFO *target);
 
-void thread_unlock(THREAD_INFO *target, THREAD_INFO *unlocker);
+// Object is the address of the sync primitive that released target.
+void thread_unlock(THREAD_INFO *target, THREAD_INFO *unlocker, void *object, WAKE_CAUSE cause);
 
 void thread_sleep(THREAD_INFO *target);
 
 int thread_has_advanced();
 
+// Number of wake ups so far, used to tell if a sync call released anyone.
+UINT64 thread_total_wakes();
+
 // Debug funtion, print thread table on stderr
 void print_threads();
 
@@ -0,0 +1,83 @@
+/* timer.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "timer.h"
+#include "log.h"
+#include <string.h>
+#include <time.h>
+#include <iostream>
+
+// Reads used to measure the cost of timer_now.
+#define CALIBRATION_READS 100000
+
+typedef struct {
+    const char *name;
+    UINT64 ns;
+} UNIT;
+
+static const UNIT units[] = {
+    {"ns", 1},
+    {"us", 1000},
+    {"ms", 1000000},
+};
+
+static struct timespec start;
+static const UNIT *unit;
+static double read_cost;
+
+static UINT64 elapsed_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (UINT64)(now.tv_sec - start.tv_sec) * 1000000000ULL + now.tv_nsec - start.tv_nsec;
+}
+
+int timer_init(const char *name)
+{
+    unit = NULL;
+    for(unsigned i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+        if(strcmp(units[i].name, name) == 0) {
+            unit = &units[i];
+        }
+    }
+    if(unit == NULL) {
+        return -1;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    // Every transition pays one read, measure it once.
+    volatile UINT64 sink = 0;
+    UINT64 begin = elapsed_ns();
+    for(int i = 0; i < CALIBRATION_READS; i++) {
+        sink += timer_now();
+    }
+    read_cost = (double)(elapsed_ns() - begin) / CALIBRATION_READS;
+    (void) sink;
+
+    // Calibration shouldn't count as execution time.
+    clock_gettime(CLOCK_MONOTONIC_RAW, &start);
+
+    DEBUG(cerr << "[Timer] Unit " << unit->name << ", read cost " << read_cost << " ns" << std::endl);
+    return 0;
+}
+
+UINT64 timer_now()
+{
+    return elapsed_ns() / unit->ns;
+}
+
+const char *timer_unit()
+{
+    return unit->name;
+}
+
+double timer_read_cost()
+{
+    return read_cost;
+}
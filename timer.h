@@ -0,0 +1,32 @@
+/* timer.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+/*
+Clock used by time-based mode (-t). It reads CLOCK_MONOTONIC_RAW, which has
+nanosecond resolution and isn't slewed by NTP, and reports time elapsed since
+timer_init in the configured unit (ns, us or ms).
+*/
+
+#include "pin.H"
+
+// Start the clock using the given unit. Returns 0 on success, -1 if the unit is unknown.
+int timer_init(const char *unit);
+
+// Time elapsed since timer_init, in the configured unit.
+UINT64 timer_now();
+
+// Name of the configured unit.
+const char *timer_unit();
+
+// Average cost of a timer_now call in ns, measured by timer_init.
+double timer_read_cost();
+
+#endif // TIMER_H_
@@ -0,0 +1,31 @@
+/* top.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "top.h"
+
+void top_init(TOP *t, int size)
+{
+    t->size = size < TOP_MAX ? size : TOP_MAX;
+    t->total = 0;
+}
+
+void top_offer(TOP *t, void *item, UINT64 key)
+{
+    // Insertion on the sorted array, dropping the smallest.
+    int pos = t->total < t->size ? t->total++ : t->size;
+    for(; pos > 0 && t->keys[pos - 1] < key; pos--) {
+        if(pos < t->size) {
+            t->items[pos] = t->items[pos - 1];
+            t->keys[pos] = t->keys[pos - 1];
+        }
+    }
+    if(pos < t->size) {
+        t->items[pos] = item;
+        t->keys[pos] = key;
+    }
+}
@@ -0,0 +1,35 @@
+/* top.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TOP_H_
+#define TOP_H_
+
+/*
+The few entries with the largest key out of many, as used by the reports of
+hot lines, pages and objects. Entries are offered one at a time and kept
+sorted by insertion, dropping the smallest once full.
+*/
+
+#include "pin.H"
+
+#define TOP_MAX 16                  // Largest size of a TOP
+
+typedef struct {
+    int size;                       // Entries kept, up to TOP_MAX
+    int total;
+    void *items[TOP_MAX];           // Largest key first
+    UINT64 keys[TOP_MAX];
+} TOP;
+
+// Empty t, keeping up to size entries.
+void top_init(TOP *t, int size);
+
+// Offer item with key, kept if it's among the largest so far.
+void top_offer(TOP *t, void *item, UINT64 key);
+
+#endif // TOP_H_
@@ -9,113 +9,334 @@
 #include "trace_bank.h"
 #include "log.h"
 #include "knob.h"
+#include "trace_binary.h"
+#include "trace_chrome.h"
+#include "out_buffer.h"
+#include "stats.h"
+#include "timer.h"
+#include "self_profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <iostream>
-#include <fstream>
-#include <sys/time.h>
 
-#define FILTER_SIZE (REDUCTION_SIZE+1)/2
+#define HEAP_SIZE (2 * MAX_BANK_SIZE)
+
+// Links a change to its neighbours once the bank is in downsampling mode.
+typedef struct {
+    int prev;
+    int next;
+    UINT32 stamp;                   // Bumped whenever the candidate starting here is outdated
+    UINT64 error;                   // How far this change was moved from its real time
+} LINK;
+
+// Merge candidate: the interval starting on slot, merging it costs key.
+typedef struct {
+    UINT64 key;
+    int slot;
+    UINT32 stamp;
+} CANDIDATE;
+
+struct _DOWNSAMPLE {
+    LINK links[MAX_BANK_SIZE];
+    CANDIDATE heap[HEAP_SIZE];
+    int heap_size;
+
+    int head;
+    int tail;
+    int free;                       // Free slots, chained by links[].next
+};
 
 static P_TRACE *traces [MAX_THREADS];
 
-// For the timed-version
-// struct timespec start;
-static struct timeval start;
+typedef struct {
+    const char *name;
+    SECTION_WRITER writer;
+} SECTION;
+
+static SECTION sections[MAX_SECTIONS];
+static int total_sections;
+
 static int pram;
+static int stats_only;
 
 void trace_bank_init(int pram_)
 {
     if(pram_ == 0) {
-        gettimeofday(&start, NULL);
+        // Unit was validated when parsing arguments.
+        timer_init(knob_time_unit.Value().c_str());
+        cerr << "[PINocchio] Timestamp cost: " << timer_read_cost() << " ns per transition" << std::endl;
     }
     pram = pram_;
+    stats_only = knob_stats_only.Value() ? 1 : 0;
 
     for(int i = 0; i < MAX_THREADS; i++) {
         traces[i] = NULL;
     }
+    total_sections = 0;
     DEBUG(cerr << "[Trace Bank] Bank Initiated" << std::endl);
 }
 
-// Filter will remove some of the smaller traces available It will look for small pairs
-// (can't remove only one, or will "change to the same state").
-static void trace_bank_filter(THREADID tid)
+/*
+Downsampling. Once a thread fills its bank, its changes are kept on a linked
+list and each new change merges away the cheapest interval. For consecutive
+changes p2, p1, k, n1 with status A, B, A, B, dropping k and n1 loses the A
+time of interval k, so p1 is moved forward by that same length. This keeps
+the A and B totals of the thread exact, while p1 ends up at most its previous
+error plus the merged length from where it was observed. That error is the
+candidate key on a min-heap, where outdated entries are skipped when popped.
+*/
+
+static void heap_swap(CANDIDATE *heap, int a, int b)
+{
+    CANDIDATE c = heap[a];
+    heap[a] = heap[b];
+    heap[b] = c;
+}
+
+static void heap_push(DOWNSAMPLE *d, CANDIDATE c)
 {
-    // List containing the indexex of interest.
-    // If here, should remove i+1 and i+2
-    int index[FILTER_SIZE];
-    UINT64 value[FILTER_SIZE];
+    int i = d->heap_size++;
+    d->heap[i] = c;
 
-    for(int i = 0; i < FILTER_SIZE; i++) {
-        index[i] = -1;
-        value[i] = 0;
+    while(i > 0) {
+        int parent = (i - 1) / 2;
+        if(d->heap[parent].key <= d->heap[i].key) {
+            break;
+        }
+        heap_swap(d->heap, parent, i);
+        i = parent;
     }
+}
 
-    for(int i = 0; i < (MAX_BANK_SIZE - 4); i++) {
-        if(traces[tid]->changes[i].status == traces[tid]->changes[i + 3].status) {
-            continue;
+static CANDIDATE heap_pop(DOWNSAMPLE *d)
+{
+    CANDIDATE top = d->heap[0];
+    d->heap[0] = d->heap[--d->heap_size];
+
+    int i = 0;
+    while(1) {
+        int left = 2 * i + 1;
+        int right = left + 1;
+        int min = i;
+
+        if(left < d->heap_size && d->heap[left].key < d->heap[min].key) {
+            min = left;
+        }
+        if(right < d->heap_size && d->heap[right].key < d->heap[min].key) {
+            min = right;
+        }
+        if(min == i) {
+            break;
         }
+        heap_swap(d->heap, min, i);
+        i = min;
+    }
 
-        UINT64 diff = traces[tid]->changes[i + 3].time - traces[tid]->changes[i].time;
-        int good = 0;
+    return top;
+}
 
-        // Insert in a insertion-sort style way.
-        for(int j = 0; j < FILTER_SIZE; j++) {
-            if((value[j] == 0) || (value[j] < diff)) {
-                // Swap if not first
-                UINT64 r = value[j];
-                int s = index[j];
+// Returns 1 if the interval starting on slot k can be merged, setting its key.
+static int candidate_key(P_TRACE *tr, int k, UINT64 *key)
+{
+    LINK *l = tr->down->links;
+    CHANGE *c = tr->changes;
 
-                value[j] = diff;
-                index[j] = i;
+    int p1 = l[k].prev;
+    int p2 = p1 >= 0 ? l[p1].prev : -1;
+    int n1 = l[k].next;
+    int nn = n1 >= 0 ? l[n1].next : -1;
 
-                if(j > 0) {
-                    value[j - 1] = r;
-                    index[j - 1] = s;
-                }
+    // Start and the last change (still open) should never move.
+    if(p2 < 0 || nn < 0) {
+        return 0;
+    }
+    if(c[p2].status != c[k].status || c[p1].status != c[n1].status) {
+        return 0;
+    }
 
-                good = 1;
-            } else {
-                break;
-            }
-        }
+    *key = (c[n1].time - c[k].time) + l[p1].error;
+    return 1;
+}
 
-        //                                                    0      1      2      3      4      5      6
-        // If taking it, can't take the next two. Reasoning: (U) -> (L) -> (U) -> (L) -> (U) -> (L) -> (U)
-        //  Removing 1, 2, 3 and 4 will result in a bigger hole. Removing 1, 2, 4 and 5 will not.
-        if(good > 0) {
-            i = i + 2;
+static void heap_rebuild(P_TRACE *tr)
+{
+    DOWNSAMPLE *d = tr->down;
+    UINT64 key;
+
+    d->heap_size = 0;
+    for(int k = d->head; k >= 0; k = d->links[k].next) {
+        if(candidate_key(tr, k, &key) > 0) {
+            CANDIDATE c = {key, k, d->links[k].stamp};
+            heap_push(d, c);
         }
     }
+}
 
-    // Elements to be removed were selected. Mark them.
-    for(int i = 0; i < FILTER_SIZE; i++) {
-        if(index[i] >= 0) {
-            traces[tid]->changes[index[i] + 1].status = UNREGISTERED;
-            traces[tid]->changes[index[i] + 2].status = UNREGISTERED;
-        }
+// Outdate the candidate starting on slot k, pushing the new one if any.
+static void candidate_update(P_TRACE *tr, int k)
+{
+    DOWNSAMPLE *d = tr->down;
+    UINT64 key;
+
+    if(k < 0) {
+        return;
+    }
+
+    d->links[k].stamp++;
+    if(candidate_key(tr, k, &key) == 0) {
+        return;
     }
 
-    // Remove the not used values. Notice it's not pretty but shouldn't happen often.
-    int jump = 0;
+    // Heap is full of outdated entries, start it again from the list.
+    if(d->heap_size >= HEAP_SIZE) {
+        heap_rebuild(tr);
+        return;
+    }
+
+    CANDIDATE c = {key, k, d->links[k].stamp};
+    heap_push(d, c);
+}
+
+// Link slots [0, total_changes) in order, the others as free, and fill the heap.
+static void downsample_relink(P_TRACE *tr)
+{
+    DOWNSAMPLE *d = tr->down;
+    int n = tr->total_changes;
+
     for(int i = 0; i < MAX_BANK_SIZE; i++) {
-        if(traces[tid]->changes[i].status == UNREGISTERED) {
-            jump++;
-        } else {
-            traces[tid]->changes[i - jump].status = traces[tid]->changes[i].status;
-            traces[tid]->changes[i - jump].time   = traces[tid]->changes[i].time;
+        d->links[i].prev = i < n ? i - 1 : -1;
+        d->links[i].next = i + 1 < MAX_BANK_SIZE ? i + 1 : -1;
+        d->links[i].stamp = 0;
+    }
+    d->links[n - 1].next = -1;
+
+    d->head = 0;
+    d->tail = n - 1;
+    d->free = n < MAX_BANK_SIZE ? n : -1;
+
+    heap_rebuild(tr);
+}
+
+static void downsample_start(P_TRACE *tr)
+{
+    DEBUG(cerr << "[Trace Bank] Downsampling started" << std::endl);
+    tr->down = (DOWNSAMPLE *) malloc(sizeof(DOWNSAMPLE));
+
+    for(int i = 0; i < MAX_BANK_SIZE; i++) {
+        tr->down->links[i].error = 0;
+    }
+    downsample_relink(tr);
+}
+
+// Put the changes back in time order on [0, total_changes), keeping errors.
+static void downsample_flatten(P_TRACE *tr)
+{
+    static CHANGE changes[MAX_BANK_SIZE];
+    static UINT64 errors[MAX_BANK_SIZE];
+    DOWNSAMPLE *d = tr->down;
+
+    if(d == NULL) {
+        return;
+    }
+
+    int n = 0;
+    for(int k = d->head; k >= 0; k = d->links[k].next) {
+        changes[n] = tr->changes[k];
+        errors[n] = d->links[k].error;
+        n++;
+    }
+
+    for(int i = 0; i < n; i++) {
+        tr->changes[i] = changes[i];
+        d->links[i].error = errors[i];
+    }
+    downsample_relink(tr);
+}
+
+// Remove the cheapest candidate, freeing two slots.
+static void downsample_merge(P_TRACE *tr)
+{
+    DOWNSAMPLE *d = tr->down;
+    LINK *l = d->links;
+    CHANGE *c = tr->changes;
+
+    while(d->heap_size > 0) {
+        CANDIDATE top = heap_pop(d);
+        int k = top.slot;
+
+        if(top.stamp != l[k].stamp) {
+            continue;
         }
+
+        int p1 = l[k].prev;
+        int p2 = l[p1].prev;
+        int n1 = l[k].next;
+        int nn = l[n1].next;
+        UINT64 length = c[n1].time - c[k].time;
+
+        // Give the length of k back to p2 status by moving p1.
+        c[p1].time += length;
+        l[p1].error += length;
+        if(l[p1].error > tr->max_error) {
+            tr->max_error = l[p1].error;
+        }
+
+        l[p1].next = nn;
+        l[nn].prev = p1;
+
+        l[k].stamp++;
+        l[n1].stamp++;
+        l[n1].next = d->free;
+        l[k].next = n1;
+        d->free = k;
+        tr->total_changes -= 2;
+
+        // Only these candidates depend on what has changed.
+        candidate_update(tr, p2);
+        candidate_update(tr, p1);
+        candidate_update(tr, l[nn].next);
+        candidate_update(tr, nn);
+        return;
     }
 
-    // Total_changes should also be updated, and here the reduction/filter is completed.
-    traces[tid]->total_changes = traces[tid]->total_changes - REDUCTION_SIZE;
+    cerr << "[PINocchio] Internal Error: Trace bank is full but nothing can be merged" << std::endl;
+    fail();
+}
+
+// Take a free slot and link it as the new tail.
+static int downsample_link(P_TRACE *tr)
+{
+    DOWNSAMPLE *d = tr->down;
+    LINK *l = d->links;
+    int slot = d->free;
+
+    d->free = l[slot].next;
+    l[slot].prev = d->tail;
+    l[slot].next = -1;
+    l[slot].error = 0;
+    l[slot].stamp++;
+    l[d->tail].next = slot;
+    d->tail = slot;
+
+    return slot;
+}
+
+// Flatten the threads still running, finished ones already are.
+static void flatten_running()
+{
+    for(int i = 0; i < MAX_THREADS; i++) {
+        if(traces[i] != NULL && traces[i]->end < 1) {
+            downsample_flatten(traces[i]);
+        }
+    }
 }
 
 void trace_bank_validate()
 {
+    flatten_running();
     for(int i = 0; i < MAX_THREADS; i++) {
-        P_TRACE *tr = traces[i];
-        if(tr != NULL) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr != NULL && tr->changes != NULL) {
             THREAD_STATUS s = tr->changes[0].status;
             UINT64 t = tr->changes[0].time;
             for(int j = 1; j < tr->total_changes; j++) {
@@ -135,35 +356,105 @@ void trace_bank_validate()
     }
 }
 
-static UINT64 diff_msec()
+// Update running totals with the interval closed by this change.
+static void trace_bank_count(P_TRACE *tr, UINT64 time, THREAD_STATUS status)
 {
-    struct timeval stop;
-    gettimeofday(&stop, NULL);
+    if(tr->last_status == UNLOCKED) {
+        tr->work += time - tr->last_time;
+        tr->span += time - tr->last_time;
+    } else if(tr->last_status == LOCKED) {
+        tr->locked += time - tr->last_time;
+    }
+
+    if(status == LOCKED) {
+        tr->blocks++;
+    }
 
-    return UINT64((stop.tv_sec - start.tv_sec) * 1000 + (stop.tv_usec - start.tv_usec) / 1000);
+    tr->last_time = time;
+    tr->last_status = status;
 }
 
-void trace_bank_update(THREADID tid, UINT64 time, THREAD_STATUS status)
+// Chain of tr up to time, which goes on while it runs.
+static UINT64 span_at(P_TRACE *tr, UINT64 time)
 {
-    int n = traces[tid]->total_changes;
-    if(n >= MAX_BANK_SIZE) {
-        // Warning: Size will change after bank filter.
-        trace_bank_filter(tid);
-        n = traces[tid]->total_changes;
+    if(pram == 0) {
+        time = timer_now();
+    }
+    if(tr->last_status == UNLOCKED && time > tr->last_time) {
+        return tr->span + (time - tr->last_time);
     }
+    return tr->span;
+}
 
-    if(pram > 0) {
-        traces[tid]->changes[n].time = time;
-    } else {
-        // Only used for time-based, no PRAM mode.
-        traces[tid]->changes[n].time = (UINT64) diff_msec();
+static CHANGE *trace_bank_append(THREADID tid, UINT64 time, THREAD_STATUS status)
+{
+    P_TRACE *tr = traces[tid];
+
+    // Only used for time-based, no PRAM mode.
+    if(pram == 0) {
+        time = timer_now();
+    }
+    trace_bank_count(tr, time, status);
+
+    // Stats only, there is no timeline to keep.
+    if(tr->changes == NULL) {
+        return NULL;
+    }
+
+    if(tr->total_changes >= MAX_BANK_SIZE) {
+        if(tr->down == NULL) {
+            downsample_start(tr);
+        }
+        UINT64 start = self_profile_enabled() > 0 ? self_profile_now() : 0;
+        downsample_merge(tr);
+        self_profile_section(SELF_TRACE_FILTER, start);
+    }
+
+    int n = tr->down != NULL ? downsample_link(tr) : tr->total_changes;
+
+    tr->changes[n].time = time;
+    tr->changes[n].status = status;
+    tr->changes[n].waker = INVALID_THREADID;
+    tr->changes[n].object = NULL;
+    tr->changes[n].cause = CAUSE_NONE;
+
+    // With a change after it, the interval two changes back can now be merged.
+    if(tr->down != NULL && tr->down->links[n].prev >= 0) {
+        candidate_update(tr, tr->down->links[tr->down->links[n].prev].prev);
+    }
+
+    tr->total_changes++;
+    return &tr->changes[n];
+}
+
+void trace_bank_update(THREADID tid, UINT64 time, THREAD_STATUS status)
+{
+    UINT64 start = self_profile_enabled() > 0 ? self_profile_now() : 0;
+    trace_bank_append(tid, time, status);
+    self_profile_section(SELF_TRACE_UPDATE, start);
+}
+
+void trace_bank_wake(THREADID tid, UINT64 time, THREADID waker, UINT64 waker_time, void *object,
+                     WAKE_CAUSE cause)
+{
+    UINT64 start = self_profile_enabled() > 0 ? self_profile_now() : 0;
+
+    // Waiting isn't on the chain, it goes on from the longer of both.
+    UINT64 span = span_at(traces[waker], waker_time);
+    if(span > traces[tid]->span) {
+        traces[tid]->span = span;
     }
-    traces[tid]->changes[n].status = status;
 
-    traces[tid]->total_changes++;
+    CHANGE *c = trace_bank_append(tid, time, UNLOCKED);
+    if(c != NULL) {
+        c->waker = waker;
+        c->object = object;
+        c->cause = cause;
+    }
+    self_profile_section(SELF_TRACE_UPDATE, start);
 }
 
-void trace_bank_register(THREADID tid, UINT64 time)
+void trace_bank_register(THREADID tid, UINT64 time, THREADID creator, UINT64 creator_time)
 {
     DEBUG(cerr << "[Trace Bank] Register: " << tid << std::endl);
     if(traces[tid] != NULL) {
@@ -175,11 +466,23 @@ void trace_bank_register(THREADID tid, UINT64 time)
     if(pram > 0) {
         traces[tid]->start = time;
     } else {
-        traces[tid]->start = diff_msec();
+        traces[tid]->start = timer_now();
     }
     traces[tid]->end = 0;
     traces[tid]->total_changes = 0;
-    traces[tid]->changes = (CHANGE *) malloc(MAX_BANK_SIZE * sizeof(CHANGE));
+    traces[tid]->changes = NULL;
+    if(stats_only == 0) {
+        traces[tid]->changes = (CHANGE *) malloc(MAX_BANK_SIZE * sizeof(CHANGE));
+    }
+    traces[tid]->max_error = 0;
+    traces[tid]->down = NULL;
+
+    traces[tid]->work = 0;
+    traces[tid]->locked = 0;
+    traces[tid]->blocks = 0;
+    traces[tid]->span = creator != INVALID_THREADID ? span_at(traces[creator], creator_time) : 0;
+    traces[tid]->last_time = 0;
+    traces[tid]->last_status = UNREGISTERED;
 
     trace_bank_update(tid, time, UNLOCKED);
 }
@@ -187,11 +490,10 @@ void trace_bank_register(THREADID tid, UINT64 time)
 void trace_bank_finish(THREADID tid, UINT64 time)
 {
     trace_bank_update(tid, time, FINISHED);
-    if(pram > 0) {
-        traces[tid]->end = time;
-    } else {
-        traces[tid]->end = diff_msec();
-    }
+    traces[tid]->end = traces[tid]->last_time;
+
+    // No more changes, leave them in time order for the readers.
+    downsample_flatten(traces[tid]);
 }
 
 static UINT64 find_end()
@@ -209,71 +511,183 @@ static UINT64 find_end()
     return max;
 }
 
-// Returns 0 if stayed unregistered the whole time
-static int make_status_string(char *s, int index)
+// Largest time shift introduced by downsampling on any thread.
+static UINT64 find_max_error()
 {
-    if(traces[index] == NULL) {
-        return 0;
+    UINT64 max = 0;
+    for(int i = 0; i < MAX_THREADS; i++) {
+        if(traces[i] != NULL && traces[i]->max_error > max) {
+            max = traces[i]->max_error;
+        }
     }
+    return max;
+}
 
-    s[0] = '\0';
-    sprintf(s, "[");
-    for(int i = 0; i < traces[index]->total_changes; i++) {
-        if(i > 0) {
-            sprintf(s, "%s, ", s);
-        }
-        char status = (char)(0x30 + traces[index]->changes[i].status);
-        sprintf(s, "%s[%lu, %c]", s, traces[index]->changes[i].time, status);
+static const char *unit_name()
+{
+    return pram > 0 ? "Cycles" : timer_unit();
+}
+
+// Write the samples list of a thread, each sample written once and in place.
+void trace_bank_add_section(const char *name, SECTION_WRITER writer)
+{
+    if(total_sections >= MAX_SECTIONS) {
+        cerr << "[PINocchio] Internal Error: Too many output sections, dropping " << name << std::endl;
+        return;
     }
-    sprintf(s, "%s]", s);
 
-    return 1;
+    sections[total_sections].name = name;
+    sections[total_sections].writer = writer;
+    total_sections++;
 }
 
-void trace_bank_dump()
+void trace_bank_dump_sections(OUT_BUFFER *b)
+{
+    for(int i = 0; i < total_sections; i++) {
+        out_buffer_str(b, ",\n  \"");
+        out_buffer_str(b, sections[i].name);
+        out_buffer_str(b, "\": ");
+        sections[i].writer(b);
+    }
+}
+
+P_TRACE *trace_bank_get(THREADID tid)
 {
-    char str[32 * MAX_BANK_SIZE];
-    ofstream f;
+    return traces[tid];
+}
 
-    DEBUG(cerr << "[Trace Bank] Dumping report to " << knob_output_file.Value() << std::endl);
-    f.open(knob_output_file.Value().c_str());
+// Write the JSON output to filename, with the extra sections if sections > 0.
+static void dump_json(const char *filename, STATS *s, UINT64 max_error, int sections)
+{
+    static OUT_BUFFER b;
 
-    f << "{\n" <<
-      "  \"end\":" << find_end() << ",\n";
-    if(pram > 0) {
-        f << "  \"unit\": \"Cycles\",\n";
-    } else {
-        f << "  \"unit\": \"ms\",\n";
+    DEBUG(cerr << "[Trace Bank] Dumping report to " << filename << std::endl);
+    if(out_buffer_open(&b, filename) < 0) {
+        cerr << "[PINocchio] Error: Can't open trace output: " << filename << std::endl;
+        return;
+    }
+
+    out_buffer_str(&b, "{\n  \"end\":");
+    out_buffer_u64(&b, find_end());
+    out_buffer_str(&b, ",\n  \"unit\": \"");
+    out_buffer_str(&b, unit_name());
+    out_buffer_str(&b, "\",\n  \"max-error\":");
+    out_buffer_u64(&b, max_error);
+    out_buffer_str(&b, ",\n  \"summary\": ");
+    stats_write(&b, s);
+    out_buffer_str(&b, ",\n");
+
+    if(pram == 0) {
+        char cost[32];
+        snprintf(cost, sizeof(cost), "%.1f", timer_read_cost());
+        out_buffer_str(&b, "  \"timer-cost-ns\": ");
+        out_buffer_str(&b, cost);
+        out_buffer_str(&b, ",\n");
     }
 
-    f << "  \"threads\": [\n";
+    out_buffer_str(&b, "  \"threads\": [\n");
     int first = 1;
     for(int i = 0; i < MAX_THREADS; i++) {
-        int exist = make_status_string(str, i);
-
-        if(exist > 0) {
-            if(first > 0) {
-                first = 0;
-            } else {
-                f << ",\n";
-            }
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
 
-            f << "    {\n" <<
-              "      \"pin-tid\":" << print_id(i) << ",\n" <<
-              "      \"start\":" << traces[i]->start << ",\n" <<
-              "      \"samples\":" << str << "\n" <<
-              "    }";
+        if(first > 0) {
+            first = 0;
+        } else {
+            out_buffer_str(&b, ",\n");
         }
+
+        out_buffer_str(&b, "    {\n      \"pin-tid\":");
+        out_buffer_u64(&b, print_id(i));
+        out_buffer_str(&b, ",\n      \"start\":");
+        out_buffer_u64(&b, tr->start);
+        out_buffer_str(&b, ",\n      \"max-error\":");
+        out_buffer_u64(&b, tr->max_error);
+        out_buffer_str(&b, ",\n      \"samples\":");
+        trace_samples_write(&b, tr->changes, tr->total_changes, print_id);
+        out_buffer_str(&b, "\n    }");
+    }
+
+    out_buffer_str(&b, "\n  ]");
+    if(sections > 0) {
+        trace_bank_dump_sections(&b);
+    }
+    out_buffer_str(&b, "\n}\n");
+    out_buffer_close(&b);
+}
+
+// Write the trace in the format picked with -f.
+static void write_trace(const char *filename, STATS *s, UINT64 max_error, int sections)
+{
+    if(knob_output_format.Value() == "binary") {
+        DEBUG(cerr << "[Trace Bank] Dumping binary report to " << filename << std::endl);
+        trace_binary_dump(filename, find_end(), unit_name());
+        return;
+    }
+
+    if(knob_output_format.Value() == "chrome") {
+        DEBUG(cerr << "[Trace Bank] Dumping chrome trace to " << filename << std::endl);
+        trace_chrome_dump(filename, unit_name());
+        return;
+    }
+
+    dump_json(filename, s, max_error, sections);
+}
+
+static void dump()
+{
+    static STATS s;
+
+    flatten_running();
+    if(stats_only > 0) {
+        DEBUG(cerr << "[Trace Bank] Dumping stats to " << knob_output_file.Value() << std::endl);
+        stats_dump(knob_output_file.Value().c_str(), unit_name());
+        return;
+    }
+
+    UINT64 max_error = find_max_error();
+    if(max_error > 0) {
+        cerr << "[PINocchio] Trace downsampled, changes moved up to " << max_error << " " << unit_name() << std::endl;
+    }
+
+    // Summary at exit, so post-processing is only needed for the details.
+    stats_compute(&s);
+    stats_print(&s, unit_name());
+
+    write_trace(knob_output_file.Value().c_str(), &s, max_error, 1);
+}
+
+void trace_bank_dump()
+{
+    UINT64 start = self_profile_enabled() > 0 ? self_profile_now() : 0;
+    dump();
+    self_profile_section(SELF_TRACE_DUMP, start);
+}
+
+void trace_bank_dump_partial(const char *filename)
+{
+    static STATS s;
+
+    flatten_running();
+    if(stats_only > 0) {
+        stats_dump(filename, unit_name());
+        return;
     }
 
-    f << "\n  ]\n}\n";
-    f.close();
+    // Sections are left out: the modules writing them are still updated by
+    // threads running outside the sync lock.
+    stats_compute(&s);
+    write_trace(filename, &s, find_max_error(), 0);
 }
 
 void trace_bank_free()
 {
     for(int i = 0; i < MAX_THREADS; i++) {
         if(traces[i] != NULL) {
+            free(traces[i]->down);
+            free(traces[i]->changes);
             free(traces[i]);
         }
     }
@@ -281,9 +695,10 @@ void trace_bank_free()
 
 void trace_bank_print()
 {
+    flatten_running();
     cerr << "[Trace Bank] Printing current state" << std::endl;
     for(int i = 0; i < MAX_THREADS; i++) {
-        P_TRACE *tr = traces[i];
+        P_TRACE *tr = trace_bank_get(i);
         if(tr != NULL) {
             cerr << "Thread: " << i << std::endl;
             cerr << "start: " << tr->start << std::endl;
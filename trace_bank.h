@@ -10,41 +10,79 @@
 #define __TRACE_H__
 
 #define MAX_BANK_SIZE 4096          // Max number of changes per threads.
-// Once it's reached, some smaller ones will be lost.
+// Once it's reached, the shortest intervals are merged, keeping per-thread
+// UNLOCKED and LOCKED totals exact but moving some changes in time.
 
-#define REDUCTION_SIZE 128          // Number of traces to be removed once limit is reached.
+#define MAX_SECTIONS 16            // Max number of extra sections on the JSON output.
 
 #include "thread.h"
+#include "out_buffer.h"
+#include "trace_samples.h"
 #include "pin.H"
 
-typedef struct {
-    UINT64 time;
-    THREAD_STATUS status;
-} CHANGE;
+// Downsampling state, only allocated once the thread fills its bank.
+typedef struct _DOWNSAMPLE DOWNSAMPLE;
 
 typedef struct {
     UINT64 start;
     UINT64 end;
 
     int total_changes;
-    CHANGE *changes;
+    CHANGE *changes;                // NULL when running with -stats-only
+
+    UINT64 max_error;               // Largest time shift introduced by downsampling
+    DOWNSAMPLE *down;
+
+    // Running totals, exact even if changes are downsampled or not kept at all.
+    UINT64 work;                    // Time spent UNLOCKED
+    UINT64 locked;                  // Time spent LOCKED
+    UINT64 blocks;                  // Number of times it got LOCKED
+    UINT64 span;                    // Longest chain of UNLOCKED time up to last_time,
+                                    // following creations and wake ups
+    UINT64 last_time;
+    THREAD_STATUS last_status;
 } P_TRACE;
 
+// Writes the value of an extra top-level section of the JSON output.
+typedef void (*SECTION_WRITER)(OUT_BUFFER *b);
+
 // Init trace bank, allocating memory and initializing required fields.
 void trace_bank_init(int pram);
 
-// Register a newly created thread. Will consider it active during start.
-void trace_bank_register(THREADID tid, UINT64 time);
+// Register a newly created thread, created by creator at creator_time
+// (INVALID_THREADID for thread 0). Will consider it active during start.
+void trace_bank_register(THREADID tid, UINT64 time, THREADID creator, UINT64 creator_time);
 
 // Insert the change on the status on the trace array.
 void trace_bank_update(THREADID tid, UINT64 time, THREAD_STATUS status);
 
+// Insert an UNLOCKED change caused by waker releasing the thread through
+// object at waker_time.
+void trace_bank_wake(THREADID tid, UINT64 time, THREADID waker, UINT64 waker_time, void *object,
+                     WAKE_CAUSE cause);
+
 // Insert the change on the status on the trace array.
 void trace_bank_finish(THREADID tid, UINT64 time);
 
-// Dump current trace bank  to external file.
+// Dump current trace bank  to external file, using the format selected by knob.
 void trace_bank_dump();
 
+// Dump the trace so far to filename on the selected output format, without the
+// extra JSON sections, as they are only complete at exit. Must hold sync_mutex
+// while running.
+void trace_bank_dump_partial(const char *filename);
+
+// Add a top-level section, written by writer, to the JSON outputs.
+void trace_bank_add_section(const char *name, SECTION_WRITER writer);
+
+// Write every added section, each one preceded by a comma.
+void trace_bank_dump_sections(OUT_BUFFER *b);
+
+// Return the trace of a given thread, NULL if it was never registered. Running
+// totals are always current, but a downsampled bank only has its changes in
+// time order once the thread finished or after a dump. Doesn't change state.
+P_TRACE *trace_bank_get(THREADID tid);
+
 // Free flusher allocated memory.
 void trace_bank_free();
 
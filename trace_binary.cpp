@@ -0,0 +1,193 @@
+/* trace_binary.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "trace_binary.h"
+#include "trace_bank.h"
+#include "log.h"
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+
+// Worst case of a block: packed status and wake bitmap, plus per sample a
+// 10 bytes time varint and a wake up (5 + 10 bytes varints and the cause).
+#define BLOCK_BUFFER_SIZE (TRACE_BINARY_BLOCK / 4 + TRACE_BINARY_BLOCK / 8 + 26 * TRACE_BINARY_BLOCK)
+
+typedef struct {
+    UINT64 first_time;
+    UINT64 offset;
+    UINT32 samples;
+} BLOCK_INDEX;
+
+typedef struct {
+    UINT32 pin_tid;
+    UINT64 start;
+    UINT64 samples;
+    UINT32 blocks;
+    UINT64 index_offset;
+} THREAD_ENTRY;
+
+static FILE *out;
+static UINT64 out_offset;
+
+static void put_bytes(const void *data, size_t size)
+{
+    fwrite(data, 1, size, out);
+    out_offset += size;
+}
+
+static void put_u8(UINT8 v)
+{
+    put_bytes(&v, 1);
+}
+
+static void put_u32(UINT32 v)
+{
+    UINT8 b[4];
+    for(int i = 0; i < 4; i++) {
+        b[i] = (UINT8)(v >> (8 * i));
+    }
+    put_bytes(b, 4);
+}
+
+static void put_u64(UINT64 v)
+{
+    UINT8 b[8];
+    for(int i = 0; i < 8; i++) {
+        b[i] = (UINT8)(v >> (8 * i));
+    }
+    put_bytes(b, 8);
+}
+
+// LEB128 style varint: 7 bits per byte, high bit set when more bytes follow.
+static int encode_varint(UINT8 *b, UINT64 v)
+{
+    int n = 0;
+    while(v >= 0x80) {
+        b[n++] = (UINT8)(v | 0x80);
+        v >>= 7;
+    }
+    b[n++] = (UINT8) v;
+    return n;
+}
+
+// Encode samples [first, first + count) as one block, returning its size.
+static int encode_block(UINT8 *b, CHANGE *changes, int first, int count)
+{
+    int status_bytes = (count + 3) / 4;
+    int n = status_bytes;
+
+    memset(b, 0, status_bytes);
+    for(int i = 0; i < count; i++) {
+        b[i / 4] |= (UINT8)((changes[first + i].status & 0x3) << (2 * (i % 4)));
+    }
+
+    UINT64 previous = 0;
+    for(int i = 0; i < count; i++) {
+        UINT64 time = changes[first + i].time;
+        n += encode_varint(&b[n], time - previous);
+        previous = time;
+    }
+
+    int wake_bytes = (count + 7) / 8;
+    UINT8 *wakes = &b[n];
+    memset(wakes, 0, wake_bytes);
+    n += wake_bytes;
+
+    for(int i = 0; i < count; i++) {
+        CHANGE *c = &changes[first + i];
+        if(c->waker == INVALID_THREADID) {
+            continue;
+        }
+
+        wakes[i / 8] |= (UINT8)(1 << (i % 8));
+        n += encode_varint(&b[n], print_id(c->waker));
+        n += encode_varint(&b[n], (UINT64)(ADDRINT) c->object);
+        b[n++] = (UINT8) c->cause;
+    }
+
+    return n;
+}
+
+// Write all blocks of a given thread followed by its index.
+static void dump_thread(P_TRACE *tr, THREAD_ENTRY *entry)
+{
+    static UINT8 block[BLOCK_BUFFER_SIZE];
+    static BLOCK_INDEX index[(MAX_BANK_SIZE + TRACE_BINARY_BLOCK - 1) / TRACE_BINARY_BLOCK];
+
+    entry->start = tr->start;
+    entry->samples = tr->total_changes;
+    entry->blocks = 0;
+
+    for(int first = 0; first < tr->total_changes; first += TRACE_BINARY_BLOCK) {
+        int count = tr->total_changes - first;
+        if(count > TRACE_BINARY_BLOCK) {
+            count = TRACE_BINARY_BLOCK;
+        }
+
+        BLOCK_INDEX *bi = &index[entry->blocks++];
+        bi->first_time = tr->changes[first].time;
+        bi->offset = out_offset;
+        bi->samples = count;
+
+        put_bytes(block, encode_block(block, tr->changes, first, count));
+    }
+
+    entry->index_offset = out_offset;
+    for(UINT32 i = 0; i < entry->blocks; i++) {
+        put_u64(index[i].first_time);
+        put_u64(index[i].offset);
+        put_u32(index[i].samples);
+    }
+}
+
+void trace_binary_dump(const char *filename, UINT64 end, const char *unit)
+{
+    static THREAD_ENTRY table[MAX_THREADS];
+    UINT32 threads = 0;
+
+    out = fopen(filename, "wb");
+    if(out == NULL) {
+        cerr << "[PINocchio] Error: Can't open binary trace output: " << filename << std::endl;
+        return;
+    }
+    out_offset = 0;
+
+    put_bytes(TRACE_BINARY_MAGIC, 8);
+    put_u32(TRACE_BINARY_VERSION);
+    put_u64(end);
+    put_u32(TRACE_BINARY_BLOCK);
+    put_u8((UINT8) strlen(unit));
+    put_bytes(unit, strlen(unit));
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        table[threads].pin_tid = print_id(i);
+        dump_thread(tr, &table[threads]);
+        threads++;
+    }
+
+    UINT64 table_offset = out_offset;
+    put_u32(threads);
+    for(UINT32 i = 0; i < threads; i++) {
+        put_u32(table[i].pin_tid);
+        put_u64(table[i].start);
+        put_u64(table[i].samples);
+        put_u32(table[i].blocks);
+        put_u64(table[i].index_offset);
+    }
+
+    put_u64(table_offset);
+    put_bytes(TRACE_BINARY_MAGIC, 8);
+
+    fclose(out);
+    DEBUG(cerr << "[Trace Binary] " << threads << " threads, " << out_offset << " bytes written" << std::endl);
+}
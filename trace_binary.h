@@ -0,0 +1,40 @@
+/* trace_binary.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TRACE_BINARY_H_
+#define TRACE_BINARY_H_
+
+/*
+Compact binary trace format. Layout (all fixed-width fields little-endian):
+
+  header:  magic[8] "PNOTRACE", u32 version, u64 end, u32 block size,
+           u8 unit length, unit name
+  data:    per thread, its blocks followed by its block index
+  table:   u32 threads, then per thread:
+           u32 pin-tid, u64 start, u64 samples, u32 blocks, u64 index offset
+  footer:  u64 table offset, magic[8] "PNOTRACE"
+
+Each block holds up to TRACE_BINARY_BLOCK samples: first the packed status
+(2 bits per sample), then the times as varints, the first one absolute and the
+others as deltas from the previous sample. Then a bitmap (1 bit per sample)
+marking wake ups, each followed, in order, by varint waker pin-tid, varint
+object address and u8 cause (WAKE_CAUSE). Index entries are u64 first time,
+u64 block offset and u32 samples, so a time window is found by a binary search
+over the index and decoding only the blocks that overlap it.
+*/
+
+#include "pin.H"
+
+#define TRACE_BINARY_MAGIC "PNOTRACE"
+#define TRACE_BINARY_VERSION 2
+#define TRACE_BINARY_BLOCK 256          // Samples per block, must be multiple of 4.
+
+// Dump current trace bank to filename using the binary format.
+void trace_binary_dump(const char *filename, UINT64 end, const char *unit);
+
+#endif // TRACE_BINARY_H_
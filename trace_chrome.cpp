@@ -0,0 +1,115 @@
+/* trace_chrome.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "trace_chrome.h"
+#include "trace_bank.h"
+#include "out_buffer.h"
+#include "log.h"
+#include <stdio.h>
+#include <iostream>
+
+static OUT_BUFFER b;
+static int first_event;
+
+// Start a new event, writing the fields all of them share.
+static void event_begin(const char *name, const char *phase, THREADID tid)
+{
+    out_buffer_str(&b, first_event > 0 ? "\n" : ",\n");
+    first_event = 0;
+
+    out_buffer_str(&b, "{\"name\":\"");
+    out_buffer_str(&b, name);
+    out_buffer_str(&b, "\",\"ph\":\"");
+    out_buffer_str(&b, phase);
+    out_buffer_str(&b, "\",\"pid\":0,\"tid\":");
+    out_buffer_u64(&b, print_id(tid));
+}
+
+static void thread_name(THREADID tid)
+{
+    event_begin("thread_name", "M", tid);
+    out_buffer_str(&b, ",\"args\":{\"name\":\"thread ");
+    out_buffer_u64(&b, print_id(tid));
+    out_buffer_str(&b, "\"}}");
+}
+
+static void interval(THREADID tid, CHANGE *from, CHANGE *to)
+{
+    event_begin(from->status == LOCKED ? "LOCKED" : "UNLOCKED", "X", tid);
+    out_buffer_str(&b, ",\"cat\":\"state\",\"ts\":");
+    out_buffer_u64(&b, from->time);
+    out_buffer_str(&b, ",\"dur\":");
+    out_buffer_u64(&b, to->time - from->time);
+    out_buffer_char(&b, '}');
+}
+
+// Flow arrow from waker to tid, both ends at the wake up time. The finish end
+// binds to the UNLOCKED interval starting there. The start carries the object.
+static void wake(THREADID tid, CHANGE *c, UINT64 id)
+{
+    char object[32];
+    snprintf(object, sizeof(object), "%p", c->object);
+
+    event_begin("wake", "s", c->waker);
+    out_buffer_str(&b, ",\"cat\":\"wake\",\"id\":");
+    out_buffer_u64(&b, id);
+    out_buffer_str(&b, ",\"ts\":");
+    out_buffer_u64(&b, c->time);
+    out_buffer_str(&b, ",\"args\":{\"object\":\"");
+    out_buffer_str(&b, object);
+    out_buffer_str(&b, "\",\"cause\":\"");
+    out_buffer_str(&b, wake_cause_name(c->cause));
+    out_buffer_str(&b, "\"}}");
+
+    event_begin("wake", "f", tid);
+    out_buffer_str(&b, ",\"cat\":\"wake\",\"bp\":\"e\",\"id\":");
+    out_buffer_u64(&b, id);
+    out_buffer_str(&b, ",\"ts\":");
+    out_buffer_u64(&b, c->time);
+    out_buffer_char(&b, '}');
+}
+
+void trace_chrome_dump(const char *filename, const char *unit)
+{
+    UINT64 flows = 0;
+
+    if(out_buffer_open(&b, filename) < 0) {
+        cerr << "[PINocchio] Error: Can't open chrome trace output: " << filename << std::endl;
+        return;
+    }
+
+    out_buffer_str(&b, "{\"otherData\":{\"unit\":\"");
+    out_buffer_str(&b, unit);
+    out_buffer_str(&b, "\"},\"traceEvents\":[");
+    first_event = 1;
+
+    for(int i = 0; i < MAX_THREADS; i++) {
+        P_TRACE *tr = trace_bank_get(i);
+        if(tr == NULL) {
+            continue;
+        }
+
+        thread_name(i);
+        for(int j = 0; j < tr->total_changes; j++) {
+            CHANGE *c = &tr->changes[j];
+
+            if(c->waker != INVALID_THREADID) {
+                wake(i, c, flows++);
+            }
+
+            // Last change (FINISHED) closes the previous interval.
+            if(j + 1 < tr->total_changes && (c->status == UNLOCKED || c->status == LOCKED)) {
+                interval(i, c, &tr->changes[j + 1]);
+            }
+        }
+    }
+
+    out_buffer_str(&b, "\n]}\n");
+    out_buffer_close(&b);
+    DEBUG(cerr << "[Trace Chrome] " << flows << " flows written" << std::endl);
+}
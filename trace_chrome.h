@@ -0,0 +1,25 @@
+/* trace_chrome.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TRACE_CHROME_H_
+#define TRACE_CHROME_H_
+
+/*
+Chrome Trace Event export, readable by chrome://tracing and ui.perfetto.dev.
+Each simulated thread is a track with one complete event per UNLOCKED or
+LOCKED interval and every wake up is a flow arrow going from the thread that
+released the lock to the woken one. Timestamps are written in the trace unit
+(one cycle or one ms is shown as one microsecond).
+*/
+
+#include "pin.H"
+
+// Dump current trace bank to filename as a Chrome Trace Event JSON.
+void trace_chrome_dump(const char *filename, const char *unit);
+
+#endif // TRACE_CHROME_H_
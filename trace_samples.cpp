@@ -0,0 +1,58 @@
+/* trace_samples.cpp
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#include "trace_samples.h"
+
+void trace_samples_write(OUT_BUFFER *b, const CHANGE *changes, int total, ID_MAP map_id)
+{
+    out_buffer_char(b, '[');
+    for(int i = 0; i < total; i++) {
+        const CHANGE *c = &changes[i];
+
+        if(i > 0) {
+            out_buffer_str(b, ", ");
+        }
+        out_buffer_char(b, '[');
+        out_buffer_u64(b, c->time);
+        out_buffer_str(b, ", ");
+        out_buffer_char(b, (char)(0x30 + c->status));
+
+        // Wake ups also say who, through which object and of what kind.
+        if(c->waker != NO_WAKER) {
+            out_buffer_str(b, ", ");
+            out_buffer_u64(b, map_id ? map_id(c->waker) : c->waker);
+            out_buffer_str(b, ", ");
+            out_buffer_u64(b, (uint64_t)(uintptr_t) c->object);
+            out_buffer_str(b, ", \"");
+            out_buffer_str(b, wake_cause_name(c->cause));
+            out_buffer_char(b, '"');
+        }
+        out_buffer_char(b, ']');
+    }
+    out_buffer_char(b, ']');
+}
+
+const char *wake_cause_name(WAKE_CAUSE cause)
+{
+    switch(cause) {
+    case CAUSE_MUTEX:
+        return "mutex";
+    case CAUSE_SEMAPHORE:
+        return "semaphore";
+    case CAUSE_RWLOCK:
+        return "rwlock";
+    case CAUSE_COND:
+        return "cond";
+    case CAUSE_JOIN:
+        return "join";
+    case CAUSE_CREATE:
+        return "create";
+    default:
+        return "none";
+    }
+}
@@ -0,0 +1,43 @@
+/* trace_samples.h
+ *
+ * Copyright (C) 2017 Alexandre Luiz Brisighello Filho
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license.  See the LICENSE file for details.
+ */
+
+#ifndef TRACE_SAMPLES_H_
+#define TRACE_SAMPLES_H_
+
+/*
+A change is one sample of a thread on the trace: when it switched status and,
+for wake ups, who released it. trace_samples_write writes a thread's changes
+as the "samples" array of trace.json. It doesn't depend on Pin, so the dump
+benchmark runs the same writer as trace_bank_dump.
+*/
+
+#include <stdint.h>
+#include "sync_types.h"
+#include "out_buffer.h"
+
+#define NO_WAKER ((uint32_t) -1)    // Same value as Pin's INVALID_THREADID
+
+typedef struct {
+    uint64_t time;
+    THREAD_STATUS status;
+    uint32_t waker;                 // Who unlocked it, NO_WAKER if not a wake up
+    void *object;                   // Sync object it was waiting on, only for wake ups
+    WAKE_CAUSE cause;
+} CHANGE;
+
+// Maps a thread id to the one shown on the outputs.
+typedef uint32_t (*ID_MAP)(uint32_t tid);
+
+// Append changes as a JSON array. Wakers are written through map_id, or as
+// they are when it's NULL.
+void trace_samples_write(OUT_BUFFER *b, const CHANGE *changes, int total, ID_MAP map_id);
+
+// Short name of a cause, as used on the outputs.
+const char *wake_cause_name(WAKE_CAUSE cause);
+
+#endif // TRACE_SAMPLES_H_